@@ -107,7 +107,7 @@ void Application::setRootContext() {
     m_engine.load(url);
 
     p_config->setLogMode();
-    p_db->init(p_config->dbPath());
+    p_db->init(p_config->dbPath(), p_config->dbBackend());
     p_core->init(p_config);
     p_tray->init(p_config, p_core, p_nodes);
 #if !defined(Q_CC_MINGW) && !defined(Q_OS_MACOS)
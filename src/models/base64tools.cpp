@@ -0,0 +1,480 @@
+#include "base64tools.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||           \
+    defined(_M_IX86)
+#define BASE64_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BASE64_TARGET(name) __attribute__((target(name)))
+#else
+#define BASE64_TARGET(name)
+#endif
+
+using namespace across;
+
+namespace {
+constexpr char STANDARD_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr char URL_SAFE_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+constexpr auto DECODE_TABLE = [] {
+    std::array<int8_t, 256> values{};
+    values.fill(-1);
+    for (int i = 0; i < 64; ++i) {
+        values[static_cast<unsigned char>(STANDARD_CHARS[i])] =
+            static_cast<int8_t>(i);
+        values[static_cast<unsigned char>(URL_SAFE_CHARS[i])] =
+            static_cast<int8_t>(i);
+    }
+    return values;
+}();
+
+// kernels only handle whole blocks of alphabet characters and return how
+// many input bytes they consumed, the scalar loops deal with the rest
+struct Kernels {
+    Base64Tools::Kernel kind;
+    size_t (*decode)(const char *data, size_t size, char *out);
+    size_t (*encode)(const char *data, size_t size, char *out,
+                     const char *chars);
+};
+
+size_t decodeBlocksScalar(const char *, size_t, char *) { return 0; }
+
+size_t encodeBlocksScalar(const char *, size_t, char *, const char *) {
+    return 0;
+}
+
+#ifdef BASE64_X86
+BASE64_TARGET("ssse3")
+__m128i inRange128(__m128i input, char low, char high) {
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(input, _mm_set1_epi8(static_cast<char>(low - 1))),
+        _mm_cmplt_epi8(input, _mm_set1_epi8(static_cast<char>(high + 1))));
+}
+
+BASE64_TARGET("ssse3")
+size_t decodeBlocksSSSE3(const char *data, size_t size, char *out) {
+    size_t consumed = 0;
+
+    while (size - consumed >= 16) {
+        auto input = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(data + consumed));
+
+        auto upper = inRange128(input, 'A', 'Z');
+        auto lower = inRange128(input, 'a', 'z');
+        auto digit = inRange128(input, '0', '9');
+        auto plus = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('+')),
+                                 _mm_cmpeq_epi8(input, _mm_set1_epi8('-')));
+        auto slash = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('/')),
+                                  _mm_cmpeq_epi8(input, _mm_set1_epi8('_')));
+
+        auto alnum = _mm_or_si128(_mm_or_si128(upper, lower), digit);
+        auto valid = _mm_or_si128(alnum, _mm_or_si128(plus, slash));
+        if (_mm_movemask_epi8(valid) != 0xffff)
+            break;
+
+        auto shift = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)),
+                         _mm_and_si128(lower, _mm_set1_epi8(-71))),
+            _mm_and_si128(digit, _mm_set1_epi8(4)));
+        auto values = _mm_or_si128(
+            _mm_and_si128(_mm_add_epi8(input, shift), alnum),
+            _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62)),
+                         _mm_and_si128(slash, _mm_set1_epi8(63))));
+
+        // 4 x 6 bits -> 24 bits per lane, then drop the empty bytes
+        auto merged =
+            _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(
+            merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1,
+                                  -1, -1, -1));
+
+        alignas(16) char bytes[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(bytes), merged);
+        std::memcpy(out, bytes, 12);
+
+        out += 12;
+        consumed += 16;
+    }
+
+    return consumed;
+}
+
+BASE64_TARGET("ssse3")
+size_t encodeBlocksSSSE3(const char *data, size_t size, char *out,
+                         const char *chars) {
+    const auto offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        static_cast<char>(chars[62] - 62), static_cast<char>(chars[63] - 63),
+        'A', 0, 0);
+    size_t consumed = 0;
+
+    // 12 bytes are encoded per round but 16 are loaded
+    while (size - consumed >= 16) {
+        auto input = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(data + consumed));
+        input = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                                      7, 6, 8, 7, 10, 9, 11,
+                                                      10));
+
+        auto high = _mm_mulhi_epu16(
+            _mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+            _mm_set1_epi32(0x04000040));
+        auto low = _mm_mullo_epi16(
+            _mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+            _mm_set1_epi32(0x01000010));
+        auto indices = _mm_or_si128(high, low);
+
+        auto slots = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        auto letters = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        slots = _mm_or_si128(slots, _mm_and_si128(letters, _mm_set1_epi8(13)));
+        auto result =
+            _mm_add_epi8(_mm_shuffle_epi8(offsets, slots), indices);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), result);
+
+        out += 16;
+        consumed += 12;
+    }
+
+    return consumed;
+}
+
+BASE64_TARGET("avx2")
+__m256i inRange256(__m256i input, char low, char high) {
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(input,
+                          _mm256_set1_epi8(static_cast<char>(low - 1))),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high + 1)),
+                          input));
+}
+
+BASE64_TARGET("avx2")
+size_t decodeBlocksAVX2(const char *data, size_t size, char *out) {
+    size_t consumed = 0;
+
+    while (size - consumed >= 32) {
+        auto input = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(data + consumed));
+
+        auto upper = inRange256(input, 'A', 'Z');
+        auto lower = inRange256(input, 'a', 'z');
+        auto digit = inRange256(input, '0', '9');
+        auto plus =
+            _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('+')),
+                            _mm256_cmpeq_epi8(input, _mm256_set1_epi8('-')));
+        auto slash =
+            _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('/')),
+                            _mm256_cmpeq_epi8(input, _mm256_set1_epi8('_')));
+
+        auto alnum = _mm256_or_si256(_mm256_or_si256(upper, lower), digit);
+        auto valid = _mm256_or_si256(alnum, _mm256_or_si256(plus, slash));
+        if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffff)
+            break;
+
+        auto shift = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-65)),
+                            _mm256_and_si256(lower, _mm256_set1_epi8(-71))),
+            _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+        auto values = _mm256_or_si256(
+            _mm256_and_si256(_mm256_add_epi8(input, shift), alnum),
+            _mm256_or_si256(_mm256_and_si256(plus, _mm256_set1_epi8(62)),
+                            _mm256_and_si256(slash, _mm256_set1_epi8(63))));
+
+        // same packing as SSSE3 per 128 bit lane, then join the lanes
+        auto merged =
+            _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(
+            merged,
+            _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                             -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                             -1, -1, -1, -1));
+        merged = _mm256_permutevar8x32_epi32(
+            merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        alignas(32) char bytes[32];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(bytes), merged);
+        std::memcpy(out, bytes, 24);
+
+        out += 24;
+        consumed += 32;
+    }
+
+    return consumed + decodeBlocksSSSE3(data + consumed, size - consumed, out);
+}
+
+BASE64_TARGET("avx2")
+size_t encodeBlocksAVX2(const char *data, size_t size, char *out,
+                        const char *chars) {
+    const auto offsets = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        static_cast<char>(chars[62] - 62), static_cast<char>(chars[63] - 63),
+        'A', 0, 0));
+    const auto order = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    size_t consumed = 0;
+
+    // each lane takes 12 bytes, the upper load reaches 28 bytes ahead
+    while (size - consumed >= 28) {
+        auto low_half = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(data + consumed));
+        auto high_half = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(data + consumed + 12));
+        auto input = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(low_half), high_half, 1);
+        input = _mm256_shuffle_epi8(input, order);
+
+        auto high = _mm256_mulhi_epu16(
+            _mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00)),
+            _mm256_set1_epi32(0x04000040));
+        auto low = _mm256_mullo_epi16(
+            _mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0)),
+            _mm256_set1_epi32(0x01000010));
+        auto indices = _mm256_or_si256(high, low);
+
+        auto slots = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        auto letters = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        slots = _mm256_or_si256(
+            slots, _mm256_and_si256(letters, _mm256_set1_epi8(13)));
+        auto result =
+            _mm256_add_epi8(_mm256_shuffle_epi8(offsets, slots), indices);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), result);
+
+        out += 32;
+        consumed += 24;
+    }
+
+    return consumed +
+           encodeBlocksSSSE3(data + consumed, size - consumed, out, chars);
+}
+
+bool hasSSSE3() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+bool hasAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // the OS has to save the upper halves of the ymm registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 ||
+        (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+constexpr Kernels SCALAR_KERNELS = {
+    .kind = Base64Tools::Kernel::scalar,
+    .decode = decodeBlocksScalar,
+    .encode = encodeBlocksScalar,
+};
+
+#ifdef BASE64_X86
+constexpr Kernels SSSE3_KERNELS = {
+    .kind = Base64Tools::Kernel::ssse3,
+    .decode = decodeBlocksSSSE3,
+    .encode = encodeBlocksSSSE3,
+};
+
+constexpr Kernels AVX2_KERNELS = {
+    .kind = Base64Tools::Kernel::avx2,
+    .decode = decodeBlocksAVX2,
+    .encode = encodeBlocksAVX2,
+};
+#endif
+
+const Kernels *supportedKernels(Base64Tools::Kernel kind) {
+    switch (kind) {
+    case Base64Tools::Kernel::automatic:
+#ifdef BASE64_X86
+        if (hasAVX2())
+            return &AVX2_KERNELS;
+
+        if (hasSSSE3())
+            return &SSSE3_KERNELS;
+#endif
+        return &SCALAR_KERNELS;
+    case Base64Tools::Kernel::scalar:
+        return &SCALAR_KERNELS;
+#ifdef BASE64_X86
+    case Base64Tools::Kernel::ssse3:
+        return hasSSSE3() ? &SSSE3_KERNELS : nullptr;
+    case Base64Tools::Kernel::avx2:
+        return hasAVX2() ? &AVX2_KERNELS : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+std::atomic<const Kernels *> &selectedKernels() {
+    static std::atomic<const Kernels *> selected =
+        supportedKernels(Base64Tools::Kernel::automatic);
+
+    return selected;
+}
+
+const Kernels &kernels() {
+    return *selectedKernels().load(std::memory_order_relaxed);
+}
+} // namespace
+
+size_t Base64Decoder::decode(const char *data, size_t size, char *out) {
+    const auto &kernel = kernels();
+    size_t written = 0;
+    size_t i = 0;
+
+    while (i < size) {
+        // the kernels work on aligned quads only
+        bool is_aligned = m_quad_size == 0;
+        if (is_aligned) {
+            auto consumed = kernel.decode(data + i, size - i, out + written);
+            i += consumed;
+            written += consumed / 4 * 3;
+        }
+
+        // step over the character that stopped the kernel and realign
+        bool is_skipped = !is_aligned;
+        while (i < size) {
+            auto c = data[i++];
+            if (DECODE_TABLE[static_cast<unsigned char>(c)] < 0)
+                is_skipped = true;
+
+            decodeChar(c, out, written);
+            if (is_skipped && m_quad_size == 0)
+                break;
+        }
+    }
+
+    return written;
+}
+
+size_t Base64Decoder::finish(char *out) {
+    size_t written = 0;
+    decodeChar('=', out, written);
+    return written;
+}
+
+void Base64Decoder::decodeChar(char c, char *out, size_t &written) {
+    if (c == '=') {
+        // two characters carry one byte, three carry two
+        if (m_quad_size > 1) {
+            auto bits = m_quad << (6 * (4 - m_quad_size));
+            out[written++] = static_cast<char>(bits >> 16);
+            if (m_quad_size == 3)
+                out[written++] = static_cast<char>(bits >> 8);
+        }
+
+        m_quad = 0;
+        m_quad_size = 0;
+        return;
+    }
+
+    auto value = DECODE_TABLE[static_cast<unsigned char>(c)];
+    if (value < 0)
+        return;
+
+    m_quad = (m_quad << 6) | static_cast<uint32_t>(value);
+    if (++m_quad_size == 4) {
+        out[written++] = static_cast<char>(m_quad >> 16);
+        out[written++] = static_cast<char>(m_quad >> 8);
+        out[written++] = static_cast<char>(m_quad);
+        m_quad = 0;
+        m_quad_size = 0;
+    }
+}
+
+std::string Base64Tools::encode(std::string_view data, Alphabet alphabet,
+                                bool padding) {
+    const auto *chars =
+        alphabet == Alphabet::url_safe ? URL_SAFE_CHARS : STANDARD_CHARS;
+
+    std::string result((data.size() + 2) / 3 * 4, '\0');
+    auto consumed =
+        kernels().encode(data.data(), data.size(), result.data(), chars);
+    auto written = consumed / 3 * 4;
+
+    auto byte = [&data](size_t index) {
+        return static_cast<uint32_t>(static_cast<unsigned char>(data[index]));
+    };
+
+    for (; data.size() - consumed >= 3; consumed += 3) {
+        auto bits =
+            byte(consumed) << 16 | byte(consumed + 1) << 8 | byte(consumed + 2);
+        result[written++] = chars[bits >> 18 & 0x3f];
+        result[written++] = chars[bits >> 12 & 0x3f];
+        result[written++] = chars[bits >> 6 & 0x3f];
+        result[written++] = chars[bits & 0x3f];
+    }
+
+    if (auto rest = data.size() - consumed; rest > 0) {
+        auto bits = byte(consumed) << 16;
+        if (rest == 2)
+            bits |= byte(consumed + 1) << 8;
+
+        result[written++] = chars[bits >> 18 & 0x3f];
+        result[written++] = chars[bits >> 12 & 0x3f];
+        if (rest == 2)
+            result[written++] = chars[bits >> 6 & 0x3f];
+        else if (padding)
+            result[written++] = '=';
+        if (padding)
+            result[written++] = '=';
+    }
+
+    result.resize(written);
+    return result;
+}
+
+std::string Base64Tools::decode(std::string_view data) {
+    std::string result(Base64Decoder::maxDecodedSize(data.size()), '\0');
+
+    Base64Decoder decoder;
+    auto written = decoder.decode(data.data(), data.size(), result.data());
+    written += decoder.finish(result.data() + written);
+
+    result.resize(written);
+    return result;
+}
+
+bool Base64Tools::setKernel(Kernel kernel) {
+    auto *selected = supportedKernels(kernel);
+    if (selected == nullptr)
+        return false;
+
+    selectedKernels().store(selected, std::memory_order_relaxed);
+    return true;
+}
+
+Base64Tools::Kernel Base64Tools::kernel() { return kernels().kind; }
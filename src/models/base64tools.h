@@ -0,0 +1,57 @@
+#ifndef BASE64TOOLS_H
+#define BASE64TOOLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace across {
+// decodes base64 piece by piece, both alphabets are accepted, '=' closes the
+// current quad and anything else such as line breaks is skipped
+class Base64Decoder {
+  public:
+    // out needs room for maxDecodedSize(size) bytes
+    size_t decode(const char *data, size_t size, char *out);
+    // flushes a trailing quad whose padding is missing
+    size_t finish(char *out);
+
+    static constexpr size_t maxDecodedSize(size_t size) {
+        return (size + 3) / 4 * 3;
+    }
+
+  private:
+    void decodeChar(char c, char *out, size_t &written);
+
+    uint32_t m_quad = 0;
+    int m_quad_size = 0;
+};
+
+// SSSE3/AVX2 kernels are picked at runtime on x86, scalar code elsewhere
+class Base64Tools {
+  public:
+    enum class Alphabet : int {
+        standard,
+        url_safe,
+    };
+
+    // automatic is the widest kernel the CPU supports
+    enum class Kernel : int {
+        automatic,
+        scalar,
+        ssse3,
+        avx2,
+    };
+
+    static std::string encode(std::string_view data,
+                              Alphabet alphabet = Alphabet::standard,
+                              bool padding = true);
+    static std::string decode(std::string_view data);
+
+    // lets tests run every kernel, false when the CPU does not support it
+    static bool setKernel(Kernel kernel);
+    static Kernel kernel();
+};
+} // namespace across
+
+#endif // BASE64TOOLS_H
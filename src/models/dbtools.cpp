@@ -1,84 +1,825 @@
 #include "dbtools.h"
+#include "serializetools.h"
 
+#include <QtSql/QSqlDriver>
+
+#include <sqlite3.h>
+#include <algorithm>
 #include <utility>
 
 using namespace across;
 using namespace across::utils;
 
-DBWorker::DBWorker(QObject *parent) : QObject(parent) {}
+StatementCache::StatementCache(qsizetype capacity) : m_capacity(capacity) {}
+
+QSqlQuery *StatementCache::acquire(QSqlDatabase &db, const QString &sql,
+                                   QSqlError &error) {
+    if (auto iter = m_entries.find(sql); iter != m_entries.end()) {
+        m_stats.hits++;
+        iter->last_used = ++m_clock;
+        return iter->query.get();
+    }
+
+    m_stats.misses++;
 
-void DBWorker::directExec(const QString &sql_str, QSqlDatabase &db) {
+    auto query = std::make_shared<QSqlQuery>(db);
+    if (!query->prepare(sql)) {
+        error = query->lastError();
+        return nullptr;
+    }
+
+    if (m_entries.size() >= m_capacity)
+        evict();
 
-    QSqlQuery query(db);
-    query.exec(sql_str);
-    emit directExecReady(query.lastError());
+    m_entries.insert(sql, {.query = query, .last_used = ++m_clock});
+    m_stats.size = m_entries.size();
+
+    return query.get();
 }
 
-void DBWorker::stepExec(const QString &sql_str, QVariantList *inputCollection,
-                        int outputColumns,
-                        QList<QVariantList> *outputCollections,
-                        const std::shared_ptr<spdlog::logger>& p_logger,
-                        QSqlDatabase &db) {
-    QSqlError result;
-    QSqlQuery query(db);
+void StatementCache::release(const QString &sql) {
+    // reset the statement so it does not hold a read lock between uses
+    if (auto iter = m_entries.find(sql); iter != m_entries.end())
+        iter->query->finish();
+}
 
-    do {
-        if (!query.prepare(sql_str)) {
-            p_logger->error("Failed to prepared: {}",
-                            query.lastError().text().toStdString());
-            break;
-        }
+void StatementCache::clear() {
+    m_entries.clear();
+    m_stats.size = 0;
+}
 
-        if (inputCollection != nullptr) {
-            for (auto &item : *inputCollection) {
-                query.addBindValue(item);
+StatementCacheStats StatementCache::stats() const { return m_stats; }
 
-                if (result = query.lastError();
-                    result.type() != QSqlError::NoError) {
-                    p_logger->error("Failed to bind: {}",
-                                    result.text().toStdString());
-                    break;
-                }
+void StatementCache::evict() {
+    auto oldest = m_entries.begin();
+    for (auto iter = m_entries.begin(); iter != m_entries.end(); ++iter) {
+        if (iter->last_used < oldest->last_used)
+            oldest = iter;
+    }
+
+    if (oldest != m_entries.end())
+        m_entries.erase(oldest);
+}
+
+DBConnection::DBConnection(QString name, bool read_only)
+    : m_name(std::move(name)), m_read_only(read_only) {}
+
+DBConnection::~DBConnection() { close(); }
+
+void DBConnection::setLogger(const std::shared_ptr<spdlog::logger> &logger) {
+    p_logger = logger;
+}
+
+bool DBConnection::open(const QString &db_path) {
+    close();
+
+    if (!QSqlDatabase::isDriverAvailable("QSQLITE")) {
+        p_logger->error("Database driver is unavailable: QSQLITE");
+        return false;
+    }
+
+    m_db = QSqlDatabase::addDatabase("QSQLITE", m_name);
+    m_db.setDatabaseName(db_path);
+
+    if (m_read_only) {
+        m_db.setConnectOptions(
+            "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    } else {
+        m_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    }
+
+    if (!m_db.open()) {
+        p_logger->error("Database open failed: {}",
+                        m_db.lastError().text().toStdString());
+        return false;
+    }
+
+    // the driver shares its handle for the sqlite3 API, QSQLITE has to be
+    // built against the SQLite this links
+    if (auto handle = m_db.driver()->handle();
+        handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0)
+        p_handle = *static_cast<sqlite3 **>(handle.data());
+
+    // WAL lets the read connections run while the writer commits, auto_vacuum
+    // only takes effect on a new database, it must come first and existing
+    // databases keep their mode
+    if (!m_read_only) {
+        for (auto &pragma : {"PRAGMA auto_vacuum = INCREMENTAL;",
+                             "PRAGMA journal_mode = WAL;",
+                             "PRAGMA synchronous = NORMAL;"}) {
+            if (auto result = exec(DBStatement{.sql = pragma});
+                result.error.type() != QSqlError::NoError) {
+                p_logger->warn("Failed to set {}: {}", pragma,
+                               result.error.text().toStdString());
             }
         }
+    }
 
-        if (!query.exec()) {
-            if (result = query.lastError();
-                result.type() != QSqlError::NoError) {
-                p_logger->error("Failed to step: {}",
-                                result.text().toStdString());
-                break;
-            }
+    return true;
+}
+
+void DBConnection::close() {
+    if (!m_db.isValid())
+        return;
+
+    if (p_logger != nullptr) {
+        auto stats = m_cache.stats();
+        p_logger->debug("Statement cache of {}: {} hits, {} misses",
+                        m_name.toStdString(), stats.hits, stats.misses);
+    }
+
+    // cached queries must be released before the connection is removed
+    m_cache.clear();
+    p_handle = nullptr;
+    m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_name);
+}
+
+bool DBConnection::isOpen() const { return m_db.isOpen(); }
+
+void DBConnection::interrupt() {
+    if (p_handle != nullptr)
+        sqlite3_interrupt(p_handle);
+}
+
+QString DBConnection::path() const { return m_db.databaseName(); }
+
+QSqlDatabase &DBConnection::database() { return m_db; }
+
+DBResult DBConnection::exec(const DBStatement &statement) {
+    DBResult result;
+
+    auto query = m_cache.acquire(m_db, statement.sql, result.error);
+    if (query == nullptr) {
+        p_logger->error("Failed to prepared: {}",
+                        result.error.text().toStdString());
+        return result;
+    }
+
+    do {
+        for (auto i = 0; i < statement.inputs.size(); ++i) {
+            query->bindValue(i, statement.inputs.at(i));
+        }
+
+        if (!query->exec()) {
+            result.error = query->lastError();
+            p_logger->error("Failed to step: {}",
+                            result.error.text().toStdString());
+            break;
         }
 
-        if (outputCollections != nullptr) {
-            while (query.next()) {
+        if (statement.output_columns > 0) {
+            while (query->next()) {
                 QVariantList temp;
-                for (auto i = 0; i < outputColumns; ++i) {
-                    temp.append(query.value(i));
+                temp.reserve(statement.output_columns);
+                for (auto i = 0; i < statement.output_columns; ++i) {
+                    temp.append(query->value(i));
                 }
-                outputCollections->append(temp);
+                result.rows.append(temp);
             }
         }
+
+        result.last_insert_id = query->lastInsertId().toLongLong();
     } while (false);
 
-    emit stepExecReady({result, query.lastInsertId().toLongLong()});
+    m_cache.release(statement.sql);
+
+    return result;
+}
+
+QList<DBResult> DBConnection::exec(const QList<DBStatement> &statements,
+                               bool transaction) {
+    QList<DBResult> results;
+
+    if (transaction && !m_db.transaction()) {
+        results.append(DBResult{.error = m_db.lastError()});
+        p_logger->error("Failed to begin transaction: {}",
+                        results.last().error.text().toStdString());
+        return results;
+    }
+
+    for (auto &statement : statements) {
+        results.append(exec(statement));
+
+        if (results.last().error.type() != QSqlError::NoError) {
+            if (transaction)
+                m_db.rollback();
+            return results;
+        }
+    }
+
+    if (transaction && !m_db.commit()) {
+        results.append(DBResult{.error = m_db.lastError()});
+        p_logger->error("Failed to commit transaction: {}",
+                        results.last().error.text().toStdString());
+        m_db.rollback();
+    }
+
+    return results;
+}
+
+QSqlError DBConnection::transaction(const std::function<QSqlError()> &body) {
+    if (!m_db.transaction()) {
+        p_logger->error("Failed to begin transaction: {}",
+                        m_db.lastError().text().toStdString());
+        return m_db.lastError();
+    }
+
+    if (auto result = body(); result.type() != QSqlError::NoError) {
+        m_db.rollback();
+        return result;
+    }
+
+    if (!m_db.commit()) {
+        auto result = m_db.lastError();
+        p_logger->error("Failed to commit transaction: {}",
+                        result.text().toStdString());
+        m_db.rollback();
+        return result;
+    }
+
+    return {};
+}
+
+StatementCacheStats DBConnection::cacheStats() const { return m_cache.stats(); }
+
+DBWorker::DBWorker(QObject *parent)
+    : QObject(parent), m_connection("across", false) {}
+
+void DBWorker::enqueue(Task task) {
+    QMutexLocker locker(&m_mutex);
+    m_tasks.enqueue(std::move(task));
+
+    // one wakeup drains every task queued before it runs
+    if (!m_is_scheduled) {
+        m_is_scheduled = true;
+        QMetaObject::invokeMethod(this, &DBWorker::drain,
+                                  Qt::QueuedConnection);
+    }
+}
+
+void DBWorker::drain() {
+    forever {
+        QQueue<Task> tasks;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_tasks.isEmpty()) {
+                m_is_scheduled = false;
+                return;
+            }
+            tasks.swap(m_tasks);
+        }
+
+        while (!tasks.isEmpty())
+            tasks.dequeue()(&m_connection);
+    }
+}
+
+QSqlError SQLiteNodeStorage::insert(DBConnection *connection, NodeInfo &node) {
+    auto result = connection->exec(DBTools::insertStatement(node));
+    node.id = result.last_insert_id;
+
+    return result.error;
+}
+
+QSqlError SQLiteNodeStorage::update(DBConnection *connection, NodeInfo &node) {
+    return connection->exec(DBTools::updateStatement(node)).error;
+}
+
+QSqlError SQLiteNodeStorage::remove(DBConnection *connection,
+                                    const QList<qint64> &nodes_id) {
+    auto statements = DBTools::nodeSetStatements(
+        "DELETE FROM nodes WHERE ID IN (%1);", {}, nodes_id);
+
+    return DBTools::batchError(connection->exec(statements, false));
+}
+
+QSqlError SQLiteNodeStorage::removeGroup(DBConnection *connection,
+                                         qint64 group_id) {
+    return connection
+        ->exec(DBStatement{
+            .sql = "DELETE FROM nodes WHERE GroupID = ?",
+            .inputs = {group_id},
+        })
+        .error;
+}
+
+QSqlError SQLiteNodeStorage::renameGroup(DBConnection *connection,
+                                         qint64 group_id,
+                                         const QString &name) {
+    return connection
+        ->exec(DBStatement{
+            .sql = "UPDATE nodes SET GroupName = ? "
+                   "WHERE GroupID = ? AND GroupName IS NOT ?;",
+            .inputs = {name, group_id, name},
+        })
+        .error;
+}
+
+QSqlError SQLiteNodeStorage::move(DBConnection *connection,
+                                  const QList<qint64> &nodes_id,
+                                  qint64 group_id) {
+    auto statements = DBTools::nodeSetStatements(
+        "UPDATE nodes SET GroupID = ?, GroupName = (SELECT Name FROM groups "
+        "WHERE ID = ?), ModifiedAt = ? WHERE ID IN (%1);",
+        {group_id, group_id, QDateTime::currentDateTime().toSecsSinceEpoch()},
+        nodes_id);
+
+    return DBTools::batchError(connection->exec(statements, false));
+}
+
+QSqlError SQLiteNodeStorage::copy(DBConnection *connection,
+                                  const QList<qint64> &nodes_id,
+                                  qint64 group_id) {
+    auto now = QDateTime::currentDateTime().toSecsSinceEpoch();
+    auto statements = DBTools::nodeSetStatements(
+        "INSERT INTO nodes (Name, GroupID, GroupName, RoutingID, RoutingName, "
+        "Protocol, Address, Port, Password, Raw, URL, Latency, Upload, "
+        "Download, CreatedAt, ModifiedAt, Outbound) "
+        "SELECT Name, ?, (SELECT Name FROM groups WHERE ID = ?), RoutingID, "
+        "RoutingName, Protocol, Address, Port, Password, Raw, URL, Latency, "
+        "0, 0, ?, ?, Outbound FROM nodes WHERE ID IN (%1) ORDER BY ID;",
+        {group_id, group_id, now, now}, nodes_id);
+
+    return DBTools::batchError(connection->exec(statements, false));
+}
+
+QSqlError SQLiteNodeStorage::setRouting(DBConnection *connection,
+                                        const QList<qint64> &nodes_id,
+                                        qint64 routing_id,
+                                        const QString &routing_name) {
+    auto statements = DBTools::nodeSetStatements(
+        "UPDATE nodes SET RoutingID = ?, RoutingName = ?, ModifiedAt = ? "
+        "WHERE ID IN (%1);",
+        {routing_id, routing_name,
+         QDateTime::currentDateTime().toSecsSinceEpoch()},
+        nodes_id);
+
+    return DBTools::batchError(connection->exec(statements, false));
+}
+
+QSqlError
+SQLiteNodeStorage::updateLatency(DBConnection *connection,
+                                 const QHash<qint64, qint64> &latencies) {
+    QList<DBStatement> statements;
+    statements.reserve(latencies.size());
+    for (auto iter = latencies.cbegin(); iter != latencies.cend(); ++iter)
+        statements.append(DBTools::latencyStatement(iter.key(), iter.value()));
+
+    return DBTools::batchError(connection->exec(statements, false));
+}
+
+QSqlError SQLiteNodeStorage::addTraffic(DBConnection *connection,
+                                        const QList<NodeTraffic> &traffics) {
+    QList<DBStatement> statements;
+    statements.reserve(traffics.size());
+    for (auto &traffic : traffics)
+        statements.append(DBTools::trafficStatement(traffic));
+
+    return DBTools::batchError(connection->exec(statements, false));
+}
+
+QPair<QSqlError, std::optional<NodeInfo>>
+SQLiteNodeStorage::get(DBConnection *connection, qint64 node_id) {
+    auto result = connection->exec(DBStatement{
+        .sql = "SELECT " + DBTools::NODE_COLUMNS + " FROM nodes WHERE ID = ?",
+        .inputs = {node_id},
+        .output_columns = 18,
+    });
+
+    auto nodes = DBTools::toNodes(result.rows);
+    if (nodes.isEmpty())
+        return {result.error, std::nullopt};
+
+    return {result.error, nodes.first()};
+}
+
+QPair<QSqlError, QList<NodeInfo>>
+SQLiteNodeStorage::list(DBConnection *connection, qint64 group_id) {
+    auto result = connection->exec(DBStatement{
+        .sql = "SELECT " + DBTools::NODE_COLUMNS +
+               " FROM nodes WHERE GroupID = ?",
+        .inputs = {group_id},
+        .output_columns = 18,
+    });
+
+    return {result.error, DBTools::toNodes(result.rows)};
+}
+
+QPair<QSqlError, QList<NodeSummary>>
+SQLiteNodeStorage::summaries(DBConnection *connection, qint64 group_id,
+                             qint64 after_id, int limit) {
+    // LIMIT -1 has no upper bound
+    auto result = connection->exec(DBStatement{
+        .sql = "SELECT ID, Name, GroupID, Protocol, Address, Port, Latency, "
+               "RoutingID, RoutingName FROM nodes WHERE GroupID = ? AND ID > ? "
+               "ORDER BY ID LIMIT ?",
+        .inputs = {group_id, after_id, limit},
+        .output_columns = 9,
+    });
+
+    return {result.error, DBTools::toNodeSummaries(result.rows)};
+}
+
+QPair<QSqlError, QList<NodeSummary>>
+SQLiteNodeStorage::summaries(DBConnection *connection,
+                             const QList<qint64> &nodes_id) {
+    DBStatement statement = {
+        .output_columns = 9,
+    };
+
+    QStringList placeholders;
+    for (auto &node_id : nodes_id) {
+        placeholders.append("?");
+        statement.inputs.append(node_id);
+    }
+
+    statement.sql =
+        QString("SELECT ID, Name, GroupID, Protocol, Address, Port, "
+                "Latency, RoutingID, RoutingName FROM nodes WHERE ID IN (%1) "
+                "ORDER BY ID")
+            .arg(placeholders.join(","));
+
+    auto result = connection->exec(statement);
+
+    return {result.error, DBTools::toNodeSummaries(result.rows)};
+}
+
+QPair<QSqlError, qsizetype> SQLiteNodeStorage::size(DBConnection *connection,
+                                                    qint64 group_id) {
+    auto result = connection->exec(DBStatement{
+        .sql = "SELECT Items FROM group_counters WHERE GroupID = ?",
+        .inputs = {group_id},
+        .output_columns = 1,
+    });
+
+    if (result.rows.isEmpty())
+        return {result.error, 0};
+
+    return {result.error, result.rows.first().first().toLongLong()};
+}
+
+QPair<QSqlError, qint64> SQLiteNodeStorage::indexOf(DBConnection *connection,
+                                                    qint64 group_id,
+                                                    qint64 node_id) {
+    auto result = connection->exec(DBStatement{
+        .sql = "SELECT CASE WHEN EXISTS (SELECT 1 FROM nodes WHERE ID = ? "
+               "AND GroupID = ?) THEN (SELECT COUNT(*) FROM nodes WHERE "
+               "GroupID = ? AND ID < ?) ELSE -1 END",
+        .inputs = {node_id, group_id, group_id, node_id},
+        .output_columns = 1,
+    });
+
+    if (result.rows.isEmpty())
+        return {result.error, -1};
+
+    return {result.error, result.rows.first().first().toLongLong()};
+}
+
+namespace {
+NodeSummary toSummary(const NodeInfo &node) {
+    return {
+        .id = node.id,
+        .name = node.name,
+        .group_id = node.group_id,
+        .protocol = node.protocol,
+        .address = node.address,
+        .port = node.port,
+        .latency = node.latency,
+        .routing_id = node.routing_id,
+        .routing_name = node.routing_name,
+    };
+}
+
+// ID order without duplicates, the way ID IN (...) ORDER BY ID reads them
+QList<qint64> sortedIDs(QList<qint64> nodes_id) {
+    std::sort(nodes_id.begin(), nodes_id.end());
+    nodes_id.erase(std::unique(nodes_id.begin(), nodes_id.end()),
+                   nodes_id.end());
+
+    return nodes_id;
+}
+} // namespace
+
+QSqlError MemoryNodeStorage::insert(DBConnection *, NodeInfo &node) {
+    DBTools::compactOutbound(node);
+
+    auto now = QDateTime::currentDateTime();
+    if (node.created_time.isNull())
+        node.created_time = now;
+    if (node.modified_time.isNull())
+        node.modified_time = now;
+
+    node.id = ++m_last_id;
+
+    // stored the way the nodes table keeps it
+    auto &stored = m_nodes[node.id] = node;
+    if (!stored.outbound.isEmpty())
+        stored.raw.clear();
+    index(stored);
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::update(DBConnection *, NodeInfo &node) {
+    DBTools::compactOutbound(node);
+    node.modified_time = QDateTime::currentDateTime();
+
+    // like an UPDATE that matches no row
+    auto iter = m_nodes.find(node.id);
+    if (iter == m_nodes.end())
+        return {};
+
+    auto created_time = iter->created_time;
+    if (iter->group_id != node.group_id) {
+        unindex(iter.value());
+        *iter = node;
+        index(iter.value());
+    } else {
+        *iter = node;
+    }
+
+    iter->created_time = created_time;
+    if (!iter->outbound.isEmpty())
+        iter->raw.clear();
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::remove(DBConnection *,
+                                    const QList<qint64> &nodes_id) {
+    for (auto &node_id : nodes_id) {
+        auto iter = m_nodes.find(node_id);
+        if (iter == m_nodes.end())
+            continue;
+
+        unindex(iter.value());
+        m_nodes.erase(iter);
+    }
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::removeGroup(DBConnection *, qint64 group_id) {
+    for (auto &node_id : m_groups.take(group_id))
+        m_nodes.remove(node_id);
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::renameGroup(DBConnection *, qint64 group_id,
+                                         const QString &name) {
+    for (auto &node_id : m_groups.value(group_id)) {
+        if (auto iter = m_nodes.find(node_id); iter != m_nodes.end())
+            iter->group_name = name;
+    }
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::move(DBConnection *connection,
+                                  const QList<qint64> &nodes_id,
+                                  qint64 group_id) {
+    auto [error, group_name] = groupName(connection, group_id);
+    if (error.type() != QSqlError::NoError)
+        return error;
+
+    auto now = QDateTime::currentDateTime();
+    for (auto &node_id : nodes_id) {
+        auto iter = m_nodes.find(node_id);
+        if (iter == m_nodes.end())
+            continue;
+
+        if (iter->group_id != group_id) {
+            unindex(iter.value());
+            iter->group_id = group_id;
+            index(iter.value());
+        }
+
+        iter->group_name = group_name;
+        iter->modified_time = now;
+    }
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::copy(DBConnection *connection,
+                                  const QList<qint64> &nodes_id,
+                                  qint64 group_id) {
+    auto [error, group_name] = groupName(connection, group_id);
+    if (error.type() != QSqlError::NoError)
+        return error;
+
+    auto now = QDateTime::currentDateTime();
+    for (auto &node_id : sortedIDs(nodes_id)) {
+        auto iter = m_nodes.constFind(node_id);
+        if (iter == m_nodes.cend())
+            continue;
+
+        NodeInfo node = iter.value();
+        node.id = ++m_last_id;
+        node.group_id = group_id;
+        node.group_name = group_name;
+        node.upload = 0;
+        node.download = 0;
+        node.created_time = now;
+        node.modified_time = now;
+
+        m_nodes.insert(node.id, node);
+        index(node);
+    }
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::setRouting(DBConnection *,
+                                        const QList<qint64> &nodes_id,
+                                        qint64 routing_id,
+                                        const QString &routing_name) {
+    auto now = QDateTime::currentDateTime();
+    for (auto &node_id : nodes_id) {
+        if (auto iter = m_nodes.find(node_id); iter != m_nodes.end()) {
+            iter->routing_id = routing_id;
+            iter->routing_name = routing_name;
+            iter->modified_time = now;
+        }
+    }
+
+    return {};
+}
+
+QSqlError
+MemoryNodeStorage::updateLatency(DBConnection *,
+                                 const QHash<qint64, qint64> &latencies) {
+    for (auto latency = latencies.cbegin(); latency != latencies.cend();
+         ++latency) {
+        if (auto iter = m_nodes.find(latency.key()); iter != m_nodes.end())
+            iter->latency = latency.value();
+    }
+
+    return {};
+}
+
+QSqlError MemoryNodeStorage::addTraffic(DBConnection *,
+                                        const QList<NodeTraffic> &traffics) {
+    for (auto &traffic : traffics) {
+        if (auto iter = m_nodes.find(traffic.node_id); iter != m_nodes.end()) {
+            iter->upload += traffic.upload;
+            iter->download += traffic.download;
+        }
+    }
+
+    return {};
+}
+
+QPair<QSqlError, std::optional<NodeInfo>>
+MemoryNodeStorage::get(DBConnection *, qint64 node_id) {
+    if (auto iter = m_nodes.constFind(node_id); iter != m_nodes.cend())
+        return {{}, iter.value()};
+
+    return {{}, std::nullopt};
+}
+
+QPair<QSqlError, QList<NodeInfo>> MemoryNodeStorage::list(DBConnection *,
+                                                          qint64 group_id) {
+    auto nodes_id = m_groups.value(group_id);
+
+    QList<NodeInfo> nodes;
+    nodes.reserve(nodes_id.size());
+    for (auto &node_id : nodes_id)
+        nodes.append(m_nodes.value(node_id));
+
+    return {{}, nodes};
+}
+
+QPair<QSqlError, QList<NodeSummary>>
+MemoryNodeStorage::summaries(DBConnection *, qint64 group_id, qint64 after_id,
+                             int limit) {
+    auto nodes_id = m_groups.value(group_id);
+
+    QList<NodeSummary> nodes;
+    for (auto iter = std::upper_bound(nodes_id.cbegin(), nodes_id.cend(),
+                                      after_id);
+         iter != nodes_id.cend() && (limit < 0 || nodes.size() < limit);
+         ++iter)
+        nodes.append(toSummary(m_nodes.value(*iter)));
+
+    return {{}, nodes};
+}
+
+QPair<QSqlError, QList<NodeSummary>>
+MemoryNodeStorage::summaries(DBConnection *, const QList<qint64> &nodes_id) {
+    QList<NodeSummary> nodes;
+    for (auto &node_id : sortedIDs(nodes_id)) {
+        if (auto iter = m_nodes.constFind(node_id); iter != m_nodes.cend())
+            nodes.append(toSummary(iter.value()));
+    }
+
+    return {{}, nodes};
+}
+
+QPair<QSqlError, qsizetype> MemoryNodeStorage::size(DBConnection *,
+                                                    qint64 group_id) {
+    return {{}, m_groups.value(group_id).size()};
+}
+
+QPair<QSqlError, qint64> MemoryNodeStorage::indexOf(DBConnection *,
+                                                    qint64 group_id,
+                                                    qint64 node_id) {
+    auto iter = m_nodes.constFind(node_id);
+    if (iter == m_nodes.cend() || iter->group_id != group_id)
+        return {{}, -1};
+
+    auto nodes_id = m_groups.value(group_id);
+    return {{},
+            std::lower_bound(nodes_id.cbegin(), nodes_id.cend(), node_id) -
+                nodes_id.cbegin()};
+}
+
+QList<QVariantList> MemoryNodeStorage::snapshot(qint64 group_id) const {
+    QList<QVariantList> rows;
+    for (auto &node_id : m_groups.value(group_id)) {
+        auto node = m_nodes.value(node_id);
+        rows.append({
+            node.id,
+            node.protocol,
+            node.address,
+            node.port,
+            node.password,
+            node.name,
+            node.raw,
+            node.url,
+            node.outbound.isEmpty() ? QVariant() : QVariant(node.outbound),
+            node.modified_time.toSecsSinceEpoch(),
+            node.group_name,
+        });
+    }
+
+    return rows;
+}
+
+void MemoryNodeStorage::clear() {
+    m_nodes.clear();
+    m_groups.clear();
+    m_last_id = 0;
+}
+
+QPair<QSqlError, QString> MemoryNodeStorage::groupName(DBConnection *connection,
+                                                       qint64 group_id) {
+    auto result = connection->exec(DBStatement{
+        .sql = "SELECT Name FROM groups WHERE ID = ?",
+        .inputs = {group_id},
+        .output_columns = 1,
+    });
+
+    if (result.rows.isEmpty())
+        return {result.error, QString()};
+
+    return {result.error, result.rows.first().first().toString()};
+}
+
+void MemoryNodeStorage::index(const NodeInfo &node) {
+    // IDs only grow, so new nodes are appended
+    auto &nodes_id = m_groups[node.group_id];
+    if (nodes_id.isEmpty() || nodes_id.last() < node.id) {
+        nodes_id.append(node.id);
+        return;
+    }
+
+    nodes_id.insert(
+        std::lower_bound(nodes_id.begin(), nodes_id.end(), node.id), node.id);
+}
+
+void MemoryNodeStorage::unindex(const NodeInfo &node) {
+    auto group = m_groups.find(node.group_id);
+    if (group == m_groups.end())
+        return;
+
+    auto iter = std::lower_bound(group->begin(), group->end(), node.id);
+    if (iter != group->end() && *iter == node.id)
+        group->erase(iter);
+
+    if (group->isEmpty())
+        m_groups.erase(group);
 }
 
 DBTools::DBTools(QObject *parent) : QObject(parent) {
     p_db_thread = new QThread(this);
     p_worker = new DBWorker();
     p_worker->moveToThread(p_db_thread);
-    connect(this, &DBTools::startDirectExec, p_worker, &DBWorker::directExec,
-            Qt::ConnectionType::BlockingQueuedConnection);
-    connect(this, &DBTools::startStepExec, p_worker, &DBWorker::stepExec,
-            Qt::ConnectionType::BlockingQueuedConnection);
-
-    connect(p_worker, &DBWorker::directExecReady, this,
-            [&](QSqlError result) { tmp_direct_res = std::move(result); });
-    connect(p_worker, &DBWorker::stepExecReady, this,
-            [&](const QPair<QSqlError, qint64>& result) { tmp_step_res = result; });
+    connect(p_db_thread, &QThread::finished, p_worker, &QObject::deleteLater);
     p_db_thread->start();
+
+    m_read_pool.setMaxThreadCount(READ_CONNECTIONS);
+    m_read_pool.setExpiryTimeout(-1);
+
+    m_latency_timer.setSingleShot(true);
+    m_latency_timer.setInterval(LATENCY_FLUSH_INTERVAL);
+    connect(&m_latency_timer, &QTimer::timeout, this, &DBTools::flushLatency);
+
+    m_maintenance_timer.setInterval(MAINTENANCE_INTERVAL);
+    connect(&m_maintenance_timer, &QTimer::timeout, this, &DBTools::maintain);
 }
 
 DBTools::~DBTools() {
@@ -87,7 +828,7 @@ DBTools::~DBTools() {
     p_db_thread->wait();
 }
 
-void DBTools::init(const QString &db_path) {
+void DBTools::init(const QString &db_path, const QString &db_backend) {
     if (auto app_logger = spdlog::get("app"); app_logger != nullptr) {
         p_logger = app_logger->clone("database");
     } else {
@@ -95,8 +836,29 @@ void DBTools::init(const QString &db_path) {
         return;
     }
 
+    submit([logger = p_logger](DBConnection *connection) {
+        connection->setLogger(logger);
+    });
+
     m_db_path = db_path;
 
+    if (auto backend =
+            magic_enum::enum_cast<DBBackend>(db_backend.toStdString());
+        backend.has_value()) {
+        m_backend = backend.value();
+    } else {
+        if (!db_backend.isEmpty())
+            p_logger->warn("Unknown database backend: {}, fall back to {}",
+                           db_backend.toStdString(),
+                           magic_enum::enum_name(DBBackend::sqlite3));
+        m_backend = DBBackend::sqlite3;
+    }
+
+    if (m_backend == DBBackend::memory)
+        p_nodes = &m_memory_nodes;
+    else
+        p_nodes = &m_sqlite_nodes;
+
     reload();
 }
 
@@ -104,7 +866,15 @@ void DBTools::reload() {
     close();
 
     do {
-        if (m_db_path.isEmpty()) {
+        QString path = m_db_path;
+        if (m_backend == DBBackend::memory) {
+            path = MEMORY_DB_PATH;
+            p_logger->info("Open in-memory node storage, search and latency "
+                           "history need an SQLite backend");
+        } else if (m_backend == DBBackend::sqlite3_memory) {
+            path = MEMORY_DB_PATH;
+            p_logger->info("Open in-memory SQLite database");
+        } else if (m_db_path.isEmpty()) {
             p_logger->error("Failed to load database on path");
             break;
         } else {
@@ -112,22 +882,15 @@ void DBTools::reload() {
                            m_db_path.toStdString());
         }
 
-        QSqlError result;
-        if (!QSqlDatabase::isDriverAvailable("QSQLITE")) {
-            p_logger->error("Database driver is unavailable: {}",
-                            m_db.driverName().toStdString());
+        m_is_open = submit([path](DBConnection *connection) {
+                        return connection->open(path);
+                    }).result();
+        if (!m_is_open)
             break;
-        }
-
-        m_db = QSqlDatabase::addDatabase("QSQLITE");
-        m_db.setDatabaseName(m_db_path);
-        if (!m_db.open()) {
-            p_logger->error("Database open failed");
-            break;
-        }
 
         p_logger->info("Successfully opened the database");
 
+        QSqlError result;
         if (result = createDefaultTables();
             result.type() != QSqlError::NoError) {
             p_logger->error("Failed to create tables: {}",
@@ -135,6 +898,12 @@ void DBTools::reload() {
             break;
         }
 
+        if (result = migrate(); result.type() != QSqlError::NoError) {
+            p_logger->error("Failed to migrate database: {}",
+                            result.text().toStdString());
+            break;
+        }
+
         if (result = createDefaultValues();
             result.type() != QSqlError::NoError) {
             p_logger->error("Failed to create values: {}",
@@ -158,11 +927,11 @@ void DBTools::reload() {
             break;
         }
 
+        m_maintenance_timer.start();
     } while (false);
 }
 
 QSqlError DBTools::createDefaultTables() {
-    QSqlError result;
     const QStringList tables = {
         {"CREATE TABLE IF NOT EXISTS groups("
          "ID INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -204,29 +973,299 @@ QSqlError DBTools::createDefaultTables() {
          "Raw TEXT NOT NULL,"
          "CreatedAt INT64 NOT NULL,"
          "ModifiedAt INT64 NOT NULL);"},
-        {"CREATE VIRTUAL TABLE IF NOT EXISTS search "
-         "USING fts5(ID, Name, GroupID, GroupName, Address);"},
-        {"CREATE TRIGGER IF NOT EXISTS search_a_i AFTER INSERT ON nodes BEGIN "
-         "INSERT INTO search VALUES (new.ID, new.Name, new.GroupID, "
-         "new.GroupName, new.Address); "
+        SEARCH_TABLE,
+        SEARCH_STATE_TABLE,
+        SEARCH_STATE_ROW,
+        SEARCH_INSERT_TRIGGER,
+        SEARCH_DELETE_TRIGGER,
+        SEARCH_UPDATE_TRIGGER,
+        {"CREATE TABLE IF NOT EXISTS group_counters("
+         "GroupID INTEGER PRIMARY KEY,"
+         "Items INTEGER NOT NULL DEFAULT 0);"},
+        {"CREATE TRIGGER IF NOT EXISTS counters_a_i AFTER INSERT ON nodes "
+         "BEGIN "
+         "INSERT OR IGNORE INTO group_counters (GroupID) VALUES (new.GroupID); "
+         "UPDATE group_counters SET Items = Items + 1 "
+         "WHERE GroupID = new.GroupID; "
+         "END;"},
+        {"CREATE TRIGGER IF NOT EXISTS counters_a_d AFTER DELETE ON nodes "
+         "BEGIN "
+         "UPDATE group_counters SET Items = Items - 1 "
+         "WHERE GroupID = old.GroupID; "
          "END;"},
-        {"CREATE TRIGGER IF NOT EXISTS search_a_d AFTER DELETE ON nodes BEGIN "
-         "DELETE FROM search WHERE ID = old.ID; "
+        {"CREATE TRIGGER IF NOT EXISTS counters_a_u AFTER UPDATE OF GroupID "
+         "ON nodes WHEN new.GroupID != old.GroupID BEGIN "
+         "UPDATE group_counters SET Items = Items - 1 "
+         "WHERE GroupID = old.GroupID; "
+         "INSERT OR IGNORE INTO group_counters (GroupID) VALUES (new.GroupID); "
+         "UPDATE group_counters SET Items = Items + 1 "
+         "WHERE GroupID = new.GroupID; "
          "END;"},
-        {"CREATE TRIGGER IF NOT EXISTS search_a_u AFTER UPDATE ON nodes BEGIN "
-         "UPDATE OR REPLACE search SET Name = new.Name,GroupID = "
-         "new.GroupID,GroupName = new.GroupName, Address = new.Address WHERE "
-         "ID = old.ID; "
+        {"CREATE TRIGGER IF NOT EXISTS counters_groups_a_d AFTER DELETE ON "
+         "groups BEGIN "
+         "DELETE FROM group_counters WHERE GroupID = old.ID; "
          "END;"},
     };
 
-    TransactionWrap transactionWrap(this);
+    QList<DBStatement> statements;
     for (auto &table : tables) {
-        if (result = directExec(table); result.type() != QSqlError::NoError)
-            break;
+        statements.append({.sql = table});
     }
 
-    return result;
+    // counters are maintained by triggers once the table exists, seed them
+    // from the current nodes when it is created
+    if (!isTableExists("group_counters")) {
+        statements.append(
+            {.sql = "INSERT OR REPLACE INTO group_counters (GroupID, Items) "
+                    "SELECT GroupID, COUNT(*) FROM nodes GROUP BY GroupID;"});
+    }
+
+    return batchError(submit(statements).result());
+}
+
+QList<DBMigration> DBTools::migrations() {
+    // append only, a released version must never be changed or reordered,
+    // its SQL is spelled out so later schema changes cannot alter it
+    return {
+        {
+            .version = 1,
+            .description = "index nodes by group",
+            .statements =
+                {
+                    {.sql = "CREATE INDEX IF NOT EXISTS nodes_group_id "
+                            "ON nodes(GroupID);"},
+                },
+        },
+        {
+            .version = 2,
+            .description = "index nodes by group latency and name",
+            .statements =
+                {
+                    {.sql = "CREATE INDEX IF NOT EXISTS nodes_group_latency "
+                            "ON nodes(GroupID, Latency);"},
+                    {.sql = "CREATE INDEX IF NOT EXISTS nodes_group_name "
+                            "ON nodes(GroupID, Name);"},
+                },
+        },
+        {
+            .version = 3,
+            .description = "limit search updates to searchable columns",
+            .statements =
+                {
+                    {.sql = "DROP TRIGGER IF EXISTS search_a_u;"},
+                    {.sql = "CREATE TRIGGER IF NOT EXISTS search_a_u "
+                            "AFTER UPDATE OF Name, GroupID, GroupName, "
+                            "Address ON nodes "
+                            "WHEN new.Name IS NOT old.Name OR "
+                            "new.GroupID IS NOT old.GroupID OR "
+                            "new.GroupName IS NOT old.GroupName OR "
+                            "new.Address IS NOT old.Address BEGIN "
+                            "UPDATE OR REPLACE search SET Name = new.Name,"
+                            "GroupID = new.GroupID,GroupName = new.GroupName, "
+                            "Address = new.Address WHERE ID = old.ID; "
+                            "END;"},
+                },
+        },
+        {
+            .version = 4,
+            .description = "record latency history",
+            .statements =
+                {
+                    {.sql = "CREATE TABLE IF NOT EXISTS latency_history("
+                            "NodeID INTEGER NOT NULL,"
+                            "MeasuredAt INT64 NOT NULL,"
+                            "Latency INTEGER NOT NULL,"
+                            "Failed BOOLEAN NOT NULL);"},
+                    {.sql = "CREATE INDEX IF NOT EXISTS latency_history_node "
+                            "ON latency_history(NodeID, MeasuredAt);"},
+                    {.sql = "CREATE TRIGGER IF NOT EXISTS latency_history_a_d "
+                            "AFTER DELETE ON nodes BEGIN "
+                            "DELETE FROM latency_history "
+                            "WHERE NodeID = old.ID; "
+                            "END;"},
+                },
+        },
+        {
+            .version = 5,
+            .description = "store share link outbounds as protobuf",
+            .statements =
+                {
+                    {.sql = "ALTER TABLE nodes ADD COLUMN Outbound BLOB;"},
+                },
+            .step = [](DBConnection *connection) -> QSqlError {
+                auto nodes = connection->exec(DBStatement{
+                    .sql = "SELECT ID, Raw, URL FROM nodes WHERE Raw != '' "
+                           "AND URL LIKE '%://%';",
+                    .output_columns = 3,
+                });
+                if (nodes.error.type() != QSqlError::NoError)
+                    return nodes.error;
+
+                for (auto &row : nodes.rows) {
+                    NodeInfo node = {
+                        .raw = row.at(1).toString(),
+                        .url = row.at(2).toString(),
+                    };
+
+                    // rows that do not parse keep their JSON
+                    compactOutbound(node);
+                    if (node.outbound.isEmpty())
+                        continue;
+
+                    if (auto res = connection->exec(DBStatement{
+                            .sql = "UPDATE nodes SET Raw = '', Outbound = ? "
+                                   "WHERE ID = ?;",
+                            .inputs = {node.outbound, row.at(0)},
+                        });
+                        res.error.type() != QSqlError::NoError)
+                        return res.error;
+                }
+
+                return {};
+            },
+        },
+        {
+            .version = 6,
+            .description = "back the search index with the nodes table",
+            .statements =
+                {
+                    {.sql = "DROP TRIGGER IF EXISTS search_a_i;"},
+                    {.sql = "DROP TRIGGER IF EXISTS search_a_d;"},
+                    {.sql = "DROP TRIGGER IF EXISTS search_a_u;"},
+                    {.sql = "DROP TABLE IF EXISTS search;"},
+                    {.sql = "CREATE VIRTUAL TABLE IF NOT EXISTS search "
+                            "USING fts5(Name, GroupName, Address, "
+                            "content='nodes', content_rowid='ID');"},
+                    {.sql = "INSERT INTO search (search) VALUES ('rebuild');"},
+                    {.sql = "CREATE TRIGGER IF NOT EXISTS search_a_i "
+                            "AFTER INSERT ON nodes BEGIN "
+                            "INSERT INTO search (rowid, Name, GroupName, "
+                            "Address) VALUES (new.ID, new.Name, "
+                            "new.GroupName, new.Address); "
+                            "END;"},
+                    {.sql = "CREATE TRIGGER IF NOT EXISTS search_a_d "
+                            "AFTER DELETE ON nodes BEGIN "
+                            "INSERT INTO search (search, rowid, Name, "
+                            "GroupName, Address) VALUES ('delete', old.ID, "
+                            "old.Name, old.GroupName, old.Address); "
+                            "END;"},
+                    {.sql = "CREATE TRIGGER IF NOT EXISTS search_a_u "
+                            "AFTER UPDATE OF Name, GroupName, Address "
+                            "ON nodes "
+                            "WHEN new.Name IS NOT old.Name OR "
+                            "new.GroupName IS NOT old.GroupName OR "
+                            "new.Address IS NOT old.Address BEGIN "
+                            "INSERT INTO search (search, rowid, Name, "
+                            "GroupName, Address) VALUES ('delete', old.ID, "
+                            "old.Name, old.GroupName, old.Address); "
+                            "INSERT INTO search (rowid, Name, GroupName, "
+                            "Address) VALUES (new.ID, new.Name, "
+                            "new.GroupName, new.Address); "
+                            "END;"},
+                },
+        },
+        {
+            .version = 7,
+            .description = "tokenize the search index into trigrams",
+            .statements =
+                {
+                    {.sql = "DROP TABLE IF EXISTS search;"},
+                    {.sql = "CREATE VIRTUAL TABLE IF NOT EXISTS search "
+                            "USING fts5(Name, GroupName, Address, "
+                            "content='nodes', content_rowid='ID', "
+                            "tokenize='trigram');"},
+                    {.sql = "INSERT INTO search (search) VALUES ('rebuild');"},
+                },
+        },
+        {
+            .version = 8,
+            .description = "suspend search inserts with a flag",
+            .statements =
+                {
+                    {.sql = "CREATE TABLE IF NOT EXISTS search_state("
+                            "ID INTEGER PRIMARY KEY CHECK (ID = 1),"
+                            "Suspended BOOLEAN NOT NULL DEFAULT 0);"},
+                    {.sql = "INSERT OR IGNORE INTO search_state (ID) "
+                            "VALUES (1);"},
+                    {.sql = "DROP TRIGGER IF EXISTS search_a_i;"},
+                    {.sql = "CREATE TRIGGER IF NOT EXISTS search_a_i "
+                            "AFTER INSERT ON nodes "
+                            "WHEN NOT EXISTS (SELECT 1 FROM search_state "
+                            "WHERE Suspended = 1) "
+                            "BEGIN "
+                            "INSERT INTO search (rowid, Name, GroupName, "
+                            "Address) VALUES (new.ID, new.Name, "
+                            "new.GroupName, new.Address); "
+                            "END;"},
+                },
+        },
+    };
+}
+
+QSqlError DBTools::execMigration(DBConnection *connection,
+                                 const DBMigration &migration) {
+    return connection->transaction([&]() -> QSqlError {
+        for (auto &statement : migration.statements) {
+            if (auto result = connection->exec(statement);
+                result.error.type() != QSqlError::NoError)
+                return result.error;
+        }
+
+        if (migration.step != nullptr) {
+            if (auto result = migration.step(connection);
+                result.type() != QSqlError::NoError)
+                return result;
+        }
+
+        return connection
+            ->exec(DBStatement{
+                .sql = "INSERT INTO schema_version (Version, Description, "
+                       "AppliedAt) VALUES (?,?,?);",
+                .inputs = {migration.version, migration.description,
+                           QDateTime::currentDateTime().toSecsSinceEpoch()},
+            })
+            .error;
+    });
+}
+
+QSqlError DBTools::migrate() {
+    const QList<DBStatement> statements = {
+        {.sql = "CREATE TABLE IF NOT EXISTS schema_version("
+                "Version INTEGER PRIMARY KEY,"
+                "Description TEXT NOT NULL,"
+                "AppliedAt INT64 NOT NULL);"},
+        {.sql = "SELECT IFNULL(MAX(Version), 0) FROM schema_version;",
+         .output_columns = 1},
+    };
+
+    return submit([statements, logger = p_logger](DBConnection *connection) {
+               auto results = connection->exec(statements, false);
+               if (auto result = batchError(results);
+                   result.type() != QSqlError::NoError)
+                   return result;
+
+               auto &rows = results.last().rows;
+               int version = rows.isEmpty() ? 0 : rows.first().first().toInt();
+
+               for (auto &migration : migrations()) {
+                   if (migration.version <= version)
+                       continue;
+
+                   if (auto result = execMigration(connection, migration);
+                       result.type() != QSqlError::NoError) {
+                       logger->error("Failed to apply migration {}: {}",
+                                     migration.version,
+                                     result.text().toStdString());
+                       return result;
+                   }
+
+                   logger->info("Applied migration {}: {}", migration.version,
+                                migration.description.toStdString());
+               }
+
+               return QSqlError();
+           })
+        .result();
 }
 
 QSqlError DBTools::createDefaultValues() {
@@ -249,12 +1288,91 @@ QSqlError DBTools::createDefaultValues() {
 QPair<QSqlError, qint64>
 DBTools::stepExec(const QString &sql_str, QVariantList *inputCollection,
                   int outputColumns, QList<QVariantList> *outputCollections) {
-    QEventLoop loop;
-    connect(p_worker, &DBWorker::stepExecReady, &loop, &QEventLoop::quit);
-    emit startStepExec(sql_str, inputCollection, outputColumns,
-                       outputCollections, p_logger, m_db);
-    loop.exec();
-    return tmp_step_res;
+    DBStatement statement = {
+        .sql = sql_str,
+        .output_columns = outputCollections != nullptr ? outputColumns : 0,
+    };
+
+    if (inputCollection != nullptr)
+        statement.inputs = *inputCollection;
+
+    auto result = submit(statement).result();
+
+    if (outputCollections != nullptr)
+        outputCollections->append(result.rows);
+
+    return {result.error, result.last_insert_id};
+}
+
+QFuture<DBResult> DBTools::submit(const DBStatement &statement) {
+    return submit([statement](DBConnection *connection) {
+        return connection->exec(statement);
+    });
+}
+
+QFuture<QList<DBResult>> DBTools::submit(const QList<DBStatement> &statements,
+                                         bool transaction) {
+    return submit([statements, transaction](DBConnection *connection) {
+        return connection->exec(statements, transaction);
+    });
+}
+
+QFuture<DBResult> DBTools::read(const DBStatement &statement) {
+    return read([statement](DBConnection *connection) {
+        return connection->exec(statement);
+    });
+}
+
+DBConnection *DBTools::readConnection(const QString &db_path) {
+    if (!m_read_connections.hasLocalData()) {
+        auto connection = new DBConnection(
+            QString("across_read_%1").arg(m_read_serial++), true);
+        connection->setLogger(p_logger);
+        m_read_connections.setLocalData(connection);
+    }
+
+    auto connection = m_read_connections.localData();
+    if (!connection->isOpen() || connection->path() != db_path)
+        connection->open(db_path);
+
+    return connection;
+}
+
+void DBTools::closeReadConnections() {
+    m_read_pool.waitForDone();
+
+    // each task holds its thread until every task has closed, so no thread
+    // is handed two of them and none is skipped
+    auto threads = m_read_pool.maxThreadCount();
+    QSemaphore closed;
+    QSemaphore released;
+    for (auto i = 0; i < threads; ++i) {
+        m_read_pool.start([this, &closed, &released] {
+            if (m_read_connections.hasLocalData())
+                m_read_connections.localData()->close();
+
+            closed.release();
+            released.acquire();
+        });
+    }
+
+    closed.acquire(threads);
+    released.release(threads);
+    m_read_pool.waitForDone();
+}
+
+StatementCacheStats DBTools::statementCacheStats() {
+    return submit([](DBConnection *connection) {
+               return connection->cacheStats();
+           })
+        .result();
+}
+
+QSqlError DBTools::batchError(const QList<DBResult> &results) {
+    if (results.isEmpty())
+        return {};
+
+    return results.last().error;
 }
 
 QSqlError DBTools::createDefaultGroup() {
@@ -286,11 +1404,7 @@ QSqlError DBTools::createDefaultRouting() {
 }
 
 QSqlError DBTools::directExec(const QString &sql_str) {
-    QEventLoop loop;
-    connect(p_worker, &DBWorker::directExecReady, &loop, &QEventLoop::quit);
-    emit startDirectExec(sql_str, m_db);
-    loop.exec();
-    return tmp_direct_res;
+    return submit(DBStatement{.sql = sql_str}).result().error;
 }
 
 QSqlError DBTools::createRuntimeValue(const RuntimeValue &value) {
@@ -325,11 +1439,14 @@ DBTools::readRuntimeValue(const RunTimeValues &key) {
     return readRuntimeValue(magic_enum::enum_name(key).data());
 }
 
-QSqlError DBTools::updateRuntimeValue(const RuntimeValue &value) {
-    QString update_str("UPDATE runtime SET Type = ?, Value = ? WHERE Name = ?");
-    QVariantList input_collection = {value.type, value.value, value.key};
+QFuture<QSqlError> DBTools::updateRuntimeValue(const RuntimeValue &value) {
+    const DBStatement statement = {
+        .sql = "UPDATE runtime SET Type = ?, Value = ? WHERE Name = ?",
+        .inputs = {value.type, value.value, value.key},
+    };
 
-    return stepExec(update_str, &input_collection).first;
+    return submit(statement).then(
+        [](const DBResult &result) { return result.error; });
 }
 
 QSqlError DBTools::deleteRuntimeValue(const QString &key) {
@@ -343,6 +1460,36 @@ QSqlError DBTools::deleteRuntimeValue(const RunTimeValues &key) {
     return deleteRuntimeValue(magic_enum::enum_name(key).data());
 }
 
+QFuture<QSqlError> DBTools::clearMissingDefaultNode() {
+    const QString key(magic_enum::enum_name(DEFAULT_NODE_ID).data());
+
+    // Value is TEXT, read it as the integer ID it holds
+    return submit([storage = p_nodes, key](DBConnection *connection) {
+        auto value = connection->exec(DBStatement{
+            .sql = "SELECT CAST(Value AS INTEGER) FROM runtime WHERE Name = ?",
+            .inputs = {key},
+            .output_columns = 1,
+        });
+        if (value.error.type() != QSqlError::NoError || value.rows.isEmpty())
+            return value.error;
+
+        auto node_id = value.rows.first().first().toLongLong();
+        if (node_id == 0)
+            return QSqlError();
+
+        auto [error, node] = storage->get(connection, node_id);
+        if (error.type() != QSqlError::NoError || node.has_value())
+            return error;
+
+        return connection
+            ->exec(DBStatement{
+                .sql = "UPDATE runtime SET Value = 0 WHERE Name = ?",
+                .inputs = {key},
+            })
+            .error;
+    });
+}
+
 qint64 DBTools::getCurrentNodeID() {
     return readRuntimeValue(RunTimeValues::CURRENT_NODE_ID)
         .value()
@@ -368,34 +1515,47 @@ qint64 DBTools::getDefaultGroupID() {
 }
 
 bool DBTools::isTableExists(const QString &table_name) {
-    if (m_db.tables().contains(table_name))
-        return true;
-    return false;
+    return submit([table_name](DBConnection *connection) {
+               return connection->database().tables().contains(table_name);
+           })
+        .result();
 }
 
 bool DBTools::isItemExists(const QString &group_name,
                            const QString &table_name) {
-    QSqlQuery query(m_db);
-    auto query_str = QString("SELECT * FROM %1 WHERE Name = ?").arg(table_name);
+    QList<QVariantList> collections;
+    QVariantList input_collection = {group_name};
+    auto query_str =
+        QString("SELECT ID FROM %1 WHERE Name = ? LIMIT 1").arg(table_name);
 
-    if (query.prepare(query_str.toStdString().c_str())) {
-        query.addBindValue(group_name);
+    if (auto result =
+            stepExec(query_str, &input_collection, 1, &collections).first;
+        result.type() != QSqlError::NoError) {
+        return false;
+    }
 
-        if (query.exec())
-            if (query.next())
-                return true;
+    return !collections.isEmpty();
+}
+
+void DBTools::compactOutbound(NodeInfo &node) {
+    // complete configs without a share link are stored as they are
+    if (!node.url.contains("://")) {
+        node.outbound.clear();
+        return;
     }
 
-    return false;
+    if (!node.outbound.isEmpty() || node.raw.isEmpty())
+        return;
+
+    v2ray::config::OutboundObject outbound;
+    if (google::protobuf::util::JsonStringToMessage(node.raw.toStdString(),
+                                                    &outbound)
+            .ok())
+        node.outbound = SerializeTools::MessageToBytes(outbound);
 }
 
-QSqlError DBTools::insert(NodeInfo &node) {
-    const QString insert_str(
-        "INSERT INTO nodes "
-        "(Name, GroupID, GroupName, RoutingID, RoutingName, "
-        "Protocol, Address, Port, Password, Raw, URL, Latency, "
-        "Upload, Download, CreatedAt, ModifiedAt) "
-        "VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)");
+QVariantList DBTools::insertValues(NodeInfo &node) {
+    compactOutbound(node);
 
     if (node.created_time.isNull()) {
         node.created_time = QDateTime::currentDateTime();
@@ -405,7 +1565,7 @@ QSqlError DBTools::insert(NodeInfo &node) {
         node.modified_time = QDateTime::currentDateTime();
     }
 
-    QVariantList input_collection = {
+    return {
         node.name,
         node.group_id,
         node.group_name,
@@ -415,83 +1575,850 @@ QSqlError DBTools::insert(NodeInfo &node) {
         node.address,
         node.port,
         node.password,
-        node.raw,
+        node.outbound.isEmpty() ? node.raw : QString(""),
         node.url,
         node.latency,
         node.upload,
         node.download,
         node.created_time.toSecsSinceEpoch(),
         node.modified_time.toSecsSinceEpoch(),
+        node.outbound.isEmpty() ? QVariant() : QVariant(node.outbound),
     };
+}
 
-    auto [result, id] = stepExec(insert_str, &input_collection);
-    node.id = id;
+DBStatement DBTools::insertStatement(NodeInfo &node) {
+    return {
+        .sql = "INSERT INTO nodes "
+               "(Name, GroupID, GroupName, RoutingID, RoutingName, "
+               "Protocol, Address, Port, Password, Raw, URL, Latency, "
+               "Upload, Download, CreatedAt, ModifiedAt, Outbound) "
+               "VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
+        .inputs = insertValues(node),
+    };
+}
 
-    return result;
+DBStatement DBTools::updateStatement(NodeInfo &node) {
+    compactOutbound(node);
+    node.modified_time = QDateTime::currentDateTime();
+
+    return {
+        .sql = "UPDATE nodes SET "
+               "Name = ?, GroupID = ?, GroupName = ?, RoutingID = ?, "
+               "RoutingName = ?, Protocol = ?, Address = ?, Port = ?, "
+               "Password = ?, Raw = ?, URL = ?, Latency = ?, Upload = ?, "
+               "Download = ?, ModifiedAt = ?, Outbound = ? "
+               "WHERE ID = ?;",
+        .inputs =
+            {
+                node.name,
+                node.group_id,
+                node.group_name,
+                node.routing_id,
+                node.routing_name,
+                node.protocol,
+                node.address,
+                node.port,
+                node.password,
+                node.outbound.isEmpty() ? node.raw : QString(""),
+                node.url,
+                node.latency,
+                node.upload,
+                node.download,
+                node.modified_time.toSecsSinceEpoch(),
+                node.outbound.isEmpty() ? QVariant() : QVariant(node.outbound),
+                node.id,
+            },
+    };
+}
+
+QSqlError DBTools::insert(NodeInfo &node) {
+    return submit([storage = p_nodes, &node](DBConnection *connection) {
+               return storage->insert(connection, node);
+           })
+        .result();
+}
+
+QFuture<QSqlError> DBTools::insertAsync(NodeInfo node) {
+    return submit(
+        [storage = p_nodes, node](DBConnection *connection) mutable {
+            return storage->insert(connection, node);
+        });
 }
 
 QSqlError DBTools::insert(QList<NodeInfo> &nodes) {
-    QSqlError result;
-    TransactionWrap transactionWrap(this);
-    for (auto &node : nodes)
-        if (result = insert(node); result.type() != QSqlError::NoError)
-            break;
-    return result;
+    return submit([storage = p_nodes, &nodes](DBConnection *connection) {
+               return connection->transaction([&]() {
+                   return insertNodes(storage, connection, nodes);
+               });
+           })
+        .result();
 }
 
-QSqlError DBTools::update(NodeInfo &node) {
-    QSqlError result;
-    const QString update_str(
-        "UPDATE nodes SET "
-        "Name = ?, GroupID = ?, GroupName = ?, RoutingID = ?, RoutingName = ?, "
-        "Protocol = ?, Address = ?, Port = ?, Password = ?, "
-        "Raw = ?, URL = ?, Latency = ?, Upload = ?, "
-        "Download = ?, ModifiedAt = ? "
-        "WHERE ID = ?;");
+QSqlError DBTools::insertNodes(NodeStorage *storage, DBConnection *connection,
+                               QList<NodeInfo> &nodes) {
+    for (auto &node : nodes) {
+        if (auto result = storage->insert(connection, node);
+            result.type() != QSqlError::NoError)
+            return result;
+    }
 
-    node.modified_time = QDateTime::currentDateTime();
-    QVariantList input_collection = {
-        node.name,
-        node.group_id,
-        node.group_name,
-        node.routing_id,
-        node.routing_name,
-        node.protocol,
-        node.address,
-        node.port,
-        node.password,
-        node.raw,
-        node.url,
-        node.latency,
-        node.upload,
-        node.download,
-        node.modified_time.toSecsSinceEpoch(),
-        node.id,
+    return {};
+}
+
+QList<DBStatement> DBTools::bulkInsertStatements(QList<NodeInfo> &nodes) {
+    const QString row_str("(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)");
+    const QString insert_str("INSERT INTO nodes "
+                             "(Name, GroupID, GroupName, RoutingID, "
+                             "RoutingName, Protocol, Address, Port, Password, "
+                             "Raw, URL, Latency, Upload, Download, CreatedAt, "
+                             "ModifiedAt, Outbound) VALUES ");
+
+    // multi-row inserts, every full chunk shares one cached statement
+    QList<DBStatement> statements;
+    for (qsizetype offset = 0; offset < nodes.size();
+         offset += BULK_INSERT_ROWS) {
+        auto rows = std::min(BULK_INSERT_ROWS, nodes.size() - offset);
+
+        QStringList values;
+        values.fill(row_str, rows);
+
+        DBStatement statement = {.sql = insert_str + values.join(",")};
+        statement.inputs.reserve(rows * NODE_INSERT_COLUMNS);
+        for (auto i = offset; i < offset + rows; ++i)
+            statement.inputs.append(insertValues(nodes[i]));
+
+        statements.append(statement);
+    }
+
+    return statements;
+}
+
+QFuture<QSqlError> DBTools::bulkInsert(QList<NodeInfo> nodes) {
+    if (nodes.isEmpty())
+        return QtFuture::makeReadyFuture(QSqlError());
+
+    // multi-row statements only pay off for the nodes table
+    if (m_backend == DBBackend::memory)
+        return submit([storage = p_nodes, nodes = std::move(nodes)](
+                          DBConnection *connection) mutable {
+            return insertNodes(storage, connection, nodes);
+        });
+
+    auto statements = bulkInsertStatements(nodes);
+
+    return submit([statements](DBConnection *connection) {
+               return execBulkInsert(connection, statements);
+           })
+        .then([logger = p_logger, size = nodes.size()](
+                  const QPair<QSqlError, qint64> &result) {
+            if (result.first.type() != QSqlError::NoError)
+                logger->error("Failed to bulk insert {} nodes: {}", size,
+                              result.first.text().toStdString());
+
+            return result.first;
+        });
+}
+
+QPair<QSqlError, qint64>
+DBTools::execBulkInsert(DBConnection *connection,
+                        const QList<DBStatement> &statements) {
+    qint64 first_id = 0;
+
+    auto result = connection->transaction([&]() -> QSqlError {
+        QSqlError res;
+        std::tie(res, first_id) = insertRows(connection, statements);
+        return res;
+    });
+
+    return {result, first_id};
+}
+
+QPair<QSqlError, qint64>
+DBTools::insertRows(DBConnection *connection,
+                    const QList<DBStatement> &statements) {
+    qint64 first_id = 0;
+
+    // the search index is filled once after the rows land instead of firing
+    // the insert trigger for every row, the caller holds the transaction so
+    // other connections never see the flag set
+    if (auto res = connection->exec(DBStatement{.sql = SEARCH_SUSPEND});
+        res.error.type() != QSqlError::NoError)
+        return {res.error, first_id};
+
+    for (auto &statement : statements) {
+        auto res = connection->exec(statement);
+        if (res.error.type() != QSqlError::NoError)
+            return {res.error, first_id};
+
+        if (first_id == 0) {
+            auto rows = statement.inputs.size() / NODE_INSERT_COLUMNS;
+            first_id = res.last_insert_id - rows + 1;
+        }
+    }
+
+    if (auto res = connection->exec(DBStatement{
+            .sql = "INSERT INTO search (rowid, Name, GroupName, Address) "
+                   "SELECT ID, Name, GroupName, Address "
+                   "FROM nodes WHERE ID >= ?;",
+            .inputs = {first_id},
+        });
+        res.error.type() != QSqlError::NoError)
+        return {res.error, first_id};
+
+    return {connection->exec(DBStatement{.sql = SEARCH_RESUME}).error,
+            first_id};
+}
+
+QString DBTools::fingerprint(EntryType protocol, const QString &address,
+                             uint port, const QString &password) {
+    return QString("%1|%2|%3|%4")
+        .arg(magic_enum::enum_integer(protocol))
+        .arg(address.trimmed().toLower())
+        .arg(port)
+        .arg(password);
+}
+
+QFuture<QPair<QSqlError, GroupSyncDelta>>
+DBTools::syncGroup(qint64 group_id, QList<NodeInfo> nodes) {
+    return submit([this, group_id,
+                   nodes = std::move(nodes)](DBConnection *connection) mutable {
+        GroupSyncDelta delta;
+        auto result = m_backend == DBBackend::memory
+                          ? syncMemoryGroup(m_memory_nodes, connection,
+                                            group_id, nodes, delta)
+                          : execSyncGroup(connection, group_id, nodes, delta);
+        invalidateGroup(group_id);
+
+        if (result.type() != QSqlError::NoError)
+            p_logger->error("Failed to sync group {}: {}", group_id,
+                            result.text().toStdString());
+
+        return qMakePair(result, delta);
+    });
+}
+
+QSqlError DBTools::execSyncGroup(DBConnection *connection, qint64 group_id,
+                                 QList<NodeInfo> &nodes,
+                                 GroupSyncDelta &delta) {
+    return connection->transaction([&]() -> QSqlError {
+        auto existing = connection->exec(syncSnapshotStatement(group_id));
+        if (existing.error.type() != QSqlError::NoError)
+            return existing.error;
+
+        auto plan = planSync(existing.rows, nodes, delta);
+        auto modified_time = QDateTime::currentDateTime().toSecsSinceEpoch();
+
+        for (auto &index : plan.changed) {
+            auto &node = nodes[index];
+            auto raw = node.outbound.isEmpty() ? node.raw : QString("");
+
+            if (auto res = connection->exec(DBStatement{
+                    .sql = "UPDATE nodes SET Name = ?, GroupName = ?, "
+                           "Address = ?, Raw = ?, URL = ?, Outbound = ?, "
+                           "ModifiedAt = ? WHERE ID = ?;",
+                    .inputs = {node.name, node.group_name, node.address, raw,
+                               node.url,
+                               node.outbound.isEmpty()
+                                   ? QVariant()
+                                   : QVariant(node.outbound),
+                               modified_time, node.id},
+                });
+                res.error.type() != QSqlError::NoError)
+                return res.error;
+        }
+
+        for (auto &node_id : plan.removed) {
+            if (auto res = connection->exec(DBStatement{
+                    .sql = "DELETE FROM nodes WHERE ID = ?;",
+                    .inputs = {node_id},
+                });
+                res.error.type() != QSqlError::NoError)
+                return res.error;
+        }
+
+        if (plan.fresh.isEmpty())
+            return {};
+
+        QList<NodeInfo> fresh_nodes;
+        fresh_nodes.reserve(plan.fresh.size());
+        for (auto &index : plan.fresh)
+            fresh_nodes.append(nodes.at(index));
+
+        auto [res, first_id] =
+            insertRows(connection, bulkInsertStatements(fresh_nodes));
+        if (res.type() != QSqlError::NoError)
+            return res;
+
+        for (auto i = 0; i < plan.fresh.size(); ++i)
+            nodes[plan.fresh.at(i)].id = first_id + i;
+
+        return {};
+    });
+}
+
+QSqlError DBTools::syncMemoryGroup(MemoryNodeStorage &storage,
+                                   DBConnection *connection, qint64 group_id,
+                                   QList<NodeInfo> &nodes,
+                                   GroupSyncDelta &delta) {
+    auto plan = planSync(storage.snapshot(group_id), nodes, delta);
+
+    // matched nodes keep their routing, latency and traffic
+    for (auto &index : plan.changed) {
+        auto &node = nodes[index];
+        auto [error, stored] = storage.get(connection, node.id);
+        if (error.type() != QSqlError::NoError)
+            return error;
+        if (!stored.has_value())
+            continue;
+
+        stored->name = node.name;
+        stored->group_name = node.group_name;
+        stored->address = node.address;
+        stored->raw = node.raw;
+        stored->url = node.url;
+        stored->outbound = node.outbound;
+        if (auto res = storage.update(connection, stored.value());
+            res.type() != QSqlError::NoError)
+            return res;
+    }
+
+    if (auto res = storage.remove(connection, plan.removed);
+        res.type() != QSqlError::NoError)
+        return res;
+
+    for (auto &index : plan.fresh) {
+        if (auto res = storage.insert(connection, nodes[index]);
+            res.type() != QSqlError::NoError)
+            return res;
+    }
+
+    return {};
+}
+
+DBStatement DBTools::syncSnapshotStatement(qint64 group_id) {
+    return {
+        .sql = "SELECT ID, Protocol, Address, Port, Password, Name, Raw, "
+               "URL, Outbound, ModifiedAt, GroupName FROM nodes "
+               "WHERE GroupID = ? ORDER BY ID",
+        .inputs = {group_id},
+        .output_columns = 11,
     };
+}
+
+QList<qint64> DBTools::syncSnapshotToken(const QList<QVariantList> &rows) {
+    // matches SELECT COUNT(*), SUM(ID), MAX(ModifiedAt) of the group
+    qint64 ids = 0;
+    qint64 modified_time = 0;
+    for (auto &row : rows) {
+        ids += row.at(0).toLongLong();
+        modified_time = std::max(modified_time, row.at(9).toLongLong());
+    }
+
+    return {rows.size(), ids, modified_time};
+}
+
+GroupSyncPlan DBTools::planSync(const QList<QVariantList> &rows,
+                                QList<NodeInfo> &nodes,
+                                GroupSyncDelta &delta) {
+    GroupSyncPlan plan;
+
+    // duplicated fingerprints are matched in listing order
+    QHash<QString, QQueue<QVariantList>> stored;
+    for (auto &row : rows) {
+        auto key = fingerprint(
+            magic_enum::enum_value<EntryType>(row.at(1).toInt()),
+            row.at(2).toString(), row.at(3).toUInt(), row.at(4).toString());
+        stored[key].enqueue(row);
+    }
+
+    for (auto i = 0; i < nodes.size(); ++i) {
+        auto &node = nodes[i];
+        auto iter = stored.find(
+            fingerprint(node.protocol, node.address, node.port, node.password));
+        if (iter == stored.end() || iter->isEmpty()) {
+            plan.fresh.append(i);
+            continue;
+        }
+
+        auto row = iter->dequeue();
+        node.id = row.at(0).toLongLong();
+
+        compactOutbound(node);
+        auto raw = node.outbound.isEmpty() ? node.raw : QString("");
+
+        if (node.address == row.at(2).toString() &&
+            node.name == row.at(5).toString() && raw == row.at(6).toString() &&
+            node.url == row.at(7).toString() &&
+            node.outbound == row.at(8).toByteArray() &&
+            node.group_name == row.at(10).toString()) {
+            ++delta.unchanged;
+            continue;
+        }
+
+        plan.changed.append(i);
+        ++delta.updated;
+    }
+
+    for (auto &remains : stored) {
+        for (auto &row : remains) {
+            plan.removed.append(row.at(0).toLongLong());
+            ++delta.removed;
+        }
+    }
+
+    delta.inserted = plan.fresh.size();
+
+    return plan;
+}
+
+QFuture<QPair<QSqlError, GroupSyncDelta>>
+DBTools::importGroup(qint64 group_id, QList<NodeInfo> nodes) {
+    // staging keeps SQL work off the writer, the memory storage has none
+    if (m_backend == DBBackend::memory)
+        return syncGroup(group_id, std::move(nodes));
+
+    auto promise =
+        std::make_shared<QPromise<QPair<QSqlError, GroupSyncDelta>>>();
+    auto future = promise->future();
+    promise->start();
+
+    auto batch = ++m_import_batch;
+
+    read([group_id](DBConnection *connection) {
+        return connection->exec(syncSnapshotStatement(group_id));
+    }).then([this, promise, group_id, batch,
+             nodes = std::move(nodes)](const DBResult &snapshot) mutable {
+        if (snapshot.error.type() != QSqlError::NoError) {
+            promise->addResult(qMakePair(snapshot.error, GroupSyncDelta()));
+            promise->finish();
+            return;
+        }
+
+        // matching and binding happen here, off the writer
+        GroupSyncDelta delta;
+        auto plan = planSync(snapshot.rows, nodes, delta);
+        auto staging = stagingStatements(batch, nodes, plan);
+        auto token = syncSnapshotToken(snapshot.rows);
+
+        submit([this, promise, group_id, batch, staging, token, delta,
+                nodes](DBConnection *connection) mutable {
+            auto result =
+                execImportGroup(connection, group_id, batch, staging, token);
+
+            // the group changed after the snapshot, match it again
+            if (result.type() == QSqlError::TransactionError) {
+                p_logger->warn("Group {} changed during import, sync it "
+                               "directly",
+                               group_id);
+                delta = {};
+                result = execSyncGroup(connection, group_id, nodes, delta);
+            }
+
+            invalidateGroup(group_id);
+            promise->addResult(qMakePair(result, delta));
+            promise->finish();
+        });
+    });
+
+    return future;
+}
+
+QList<DBStatement> DBTools::stagingStatements(qint64 batch,
+                                              QList<NodeInfo> &nodes,
+                                              const GroupSyncPlan &plan) {
+    const QString row_str("(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)");
+    const QString insert_str("INSERT INTO nodes_staging "
+                             "(Batch, NodeID, Name, GroupID, GroupName, "
+                             "RoutingID, RoutingName, Protocol, Address, "
+                             "Port, Password, Raw, URL, Latency, Upload, "
+                             "Download, CreatedAt, ModifiedAt, Outbound) "
+                             "VALUES ");
+
+    // changed rows first, fresh rows keep their listing order after them
+    auto indexes = plan.changed + plan.fresh;
+
+    QList<DBStatement> statements;
+    for (qsizetype offset = 0; offset < indexes.size();
+         offset += STAGING_ROWS) {
+        auto rows = std::min(STAGING_ROWS, indexes.size() - offset);
+
+        QStringList values;
+        values.fill(row_str, rows);
+
+        DBStatement statement = {.sql = insert_str + values.join(",")};
+        statement.inputs.reserve(rows * (NODE_INSERT_COLUMNS + 2));
+        for (auto i = offset; i < offset + rows; ++i) {
+            auto &node = nodes[indexes.at(i)];
+            statement.inputs << batch
+                             << (node.id > 0 ? QVariant(node.id) : QVariant());
+            statement.inputs.append(insertValues(node));
+        }
+
+        statements.append(statement);
+    }
+
+    for (qsizetype offset = 0; offset < plan.removed.size();
+         offset += BULK_INSERT_ROWS) {
+        auto rows = std::min(BULK_INSERT_ROWS, plan.removed.size() - offset);
+
+        QStringList values;
+        values.fill("(?,?)", rows);
+
+        DBStatement statement = {
+            .sql = "INSERT INTO nodes_staging_removed (Batch, ID) VALUES " +
+                   values.join(","),
+        };
+        for (auto i = offset; i < offset + rows; ++i)
+            statement.inputs << batch << plan.removed.at(i);
+
+        statements.append(statement);
+    }
+
+    return statements;
+}
+
+QSqlError DBTools::execImportGroup(DBConnection *connection, qint64 group_id,
+                                   qint64 batch,
+                                   const QList<DBStatement> &staging,
+                                   const QList<qint64> &token) {
+    const QList<DBStatement> cleanup = {
+        {.sql = "DELETE FROM nodes_staging WHERE Batch = ?;",
+         .inputs = {batch}},
+        {.sql = "DELETE FROM nodes_staging_removed WHERE Batch = ?;",
+         .inputs = {batch}},
+    };
+
+    QList<DBStatement> tables;
+    for (auto &sql : STAGING_TABLES)
+        tables.append({.sql = sql});
+
+    // only the temporary database is written here, readers and the main
+    // database stay unlocked
+    if (auto result = batchError(connection->exec(tables + staging));
+        result.type() != QSqlError::NoError) {
+        connection->exec(cleanup);
+        return result;
+    }
+
+    auto current = connection->exec(DBStatement{
+        .sql = "SELECT COUNT(*), IFNULL(SUM(ID), 0), "
+               "IFNULL(MAX(ModifiedAt), 0) FROM nodes WHERE GroupID = ?;",
+        .inputs = {group_id},
+        .output_columns = 3,
+    });
+    if (current.error.type() != QSqlError::NoError) {
+        connection->exec(cleanup);
+        return current.error;
+    }
+
+    QList<qint64> current_token;
+    for (auto &value : current.rows.value(0))
+        current_token.append(value.toLongLong());
+
+    if (current_token != token) {
+        connection->exec(cleanup);
+        return {"", "stale snapshot", QSqlError::TransactionError};
+    }
+
+    auto result = connection->transaction([&]() -> QSqlError {
+        auto sequence = connection->exec(DBStatement{
+            .sql = "SELECT IFNULL(MAX(seq), 0) FROM sqlite_sequence "
+                   "WHERE name = 'nodes';",
+            .output_columns = 1,
+        });
+        if (sequence.error.type() != QSqlError::NoError)
+            return sequence.error;
+
+        // the search index is back-filled once, as in insertRows
+        const QList<DBStatement> swap = {
+            {.sql = "DELETE FROM nodes WHERE ID IN (SELECT ID FROM "
+                    "nodes_staging_removed WHERE Batch = ?);",
+             .inputs = {batch}},
+            {.sql = "UPDATE nodes SET Name = staged.Name, "
+                    "GroupName = staged.GroupName, "
+                    "Address = staged.Address, Raw = staged.Raw, "
+                    "URL = staged.URL, Outbound = staged.Outbound, "
+                    "ModifiedAt = staged.ModifiedAt "
+                    "FROM nodes_staging AS staged "
+                    "WHERE staged.Batch = ? AND nodes.ID = staged.NodeID;",
+             .inputs = {batch}},
+            {.sql = SEARCH_SUSPEND},
+            {.sql = "INSERT INTO nodes (Name, GroupID, GroupName, RoutingID, "
+                    "RoutingName, Protocol, Address, Port, Password, Raw, "
+                    "URL, Latency, Upload, Download, CreatedAt, ModifiedAt, "
+                    "Outbound) "
+                    "SELECT Name, GroupID, GroupName, RoutingID, "
+                    "RoutingName, Protocol, Address, Port, Password, Raw, "
+                    "URL, Latency, Upload, Download, CreatedAt, ModifiedAt, "
+                    "Outbound FROM nodes_staging "
+                    "WHERE Batch = ? AND NodeID IS NULL ORDER BY Position;",
+             .inputs = {batch}},
+            {.sql = "INSERT INTO search (rowid, Name, GroupName, Address) "
+                    "SELECT ID, Name, GroupName, Address "
+                    "FROM nodes WHERE ID > ?;",
+             .inputs = {sequence.rows.value(0).value(0)}},
+            {.sql = SEARCH_RESUME},
+        };
+
+        return batchError(connection->exec(swap, false));
+    });
+
+    connection->exec(cleanup);
+
+    return result;
+}
+
+QSqlError DBTools::update(NodeInfo &node) {
+    QSqlError result;
 
-    if (result = stepExec(update_str, &input_collection).first;
+    if (result = submit([storage = p_nodes, &node](DBConnection *connection) {
+                     return storage->update(connection, node);
+                 }).result();
         result.type() != QSqlError::NoError) {
         p_logger->error("Failed to update node: {}", node.id);
     }
+    invalidateNode(node.id);
 
     return result;
 }
 
 QSqlError DBTools::update(QList<NodeInfo> &nodes) {
-    QSqlError result;
-    TransactionWrap transactionWrap(this);
+    QList<qint64> nodes_id;
+    nodes_id.reserve(nodes.size());
     for (auto &node : nodes)
-        if (result = update(node); result.type() != QSqlError::NoError)
-            break;
+        nodes_id.append(node.id);
+
+    auto result =
+        submit([storage = p_nodes, &nodes](DBConnection *connection) {
+            return connection->transaction([&]() -> QSqlError {
+                for (auto &node : nodes) {
+                    if (auto res = storage->update(connection, node);
+                        res.type() != QSqlError::NoError)
+                        return res;
+                }
+
+                return {};
+            });
+        }).result();
+    invalidateNodes(nodes_id);
+
     return result;
 }
 
-QSqlError DBTools::insert(GroupInfo &group) {
-    const QString insert_str(
-        "INSERT INTO groups "
-        "(Name, IsSubscription, Type, Url, CycleTime, CreatedAt, ModifiedAt)"
-        "VALUES(?,?,?,?,?,?,?)");
+QFuture<QSqlError> DBTools::updateAsync(NodeInfo node) {
+    return submit([storage = p_nodes, node](DBConnection *connection) mutable {
+               return storage->update(connection, node);
+           })
+        .then([this, node_id = node.id](const QSqlError &result) {
+            invalidateNode(node_id);
+            return result;
+        });
+}
+
+DBStatement DBTools::latencyStatement(qint64 node_id, qint64 latency) {
+    return {
+        .sql = "UPDATE nodes SET Latency = ? WHERE ID = ?;",
+        .inputs = {latency, node_id},
+    };
+}
+
+DBStatement DBTools::trafficStatement(const NodeTraffic &traffic) {
+    return {
+        .sql = "UPDATE nodes SET Upload = IFNULL(Upload, 0) + ?, "
+               "Download = IFNULL(Download, 0) + ? WHERE ID = ?;",
+        .inputs = {traffic.upload, traffic.download, traffic.node_id},
+    };
+}
+
+QFuture<QSqlError> DBTools::updateLatency(qint64 node_id, qint64 latency) {
+    return updateLatency(QHash<qint64, qint64>{{node_id, latency}});
+}
+
+QFuture<QSqlError>
+DBTools::updateLatency(const QHash<qint64, qint64> &latencies) {
+    return submit([storage = p_nodes, latencies](DBConnection *connection) {
+               return connection->transaction([&]() {
+                   return storage->updateLatency(connection, latencies);
+               });
+           })
+        .then([this, nodes_id = latencies.keys()](const QSqlError &result) {
+            invalidateNodes(nodes_id);
+            return result;
+        });
+}
+
+QFuture<QSqlError> DBTools::updateTraffic(const NodeTraffic &traffic) {
+    return updateTraffic(QList<NodeTraffic>{traffic});
+}
+
+QFuture<QSqlError> DBTools::updateTraffic(const QList<NodeTraffic> &traffics) {
+    QList<qint64> nodes_id;
+    nodes_id.reserve(traffics.size());
+    for (auto &traffic : traffics)
+        nodes_id.append(traffic.node_id);
+
+    return submit([storage = p_nodes, traffics](DBConnection *connection) {
+               return connection->transaction([&]() {
+                   return storage->addTraffic(connection, traffics);
+               });
+           })
+        .then([this, nodes_id](const QSqlError &result) {
+            invalidateNodes(nodes_id);
+            return result;
+        });
+}
+
+void DBTools::queueLatency(qint64 node_id, qint64 latency) {
+    qsizetype size;
+    {
+        QMutexLocker locker(&m_latency_mutex);
+        m_pending_latency.insert(node_id, latency);
+        m_pending_samples.append({
+            .node_id = node_id,
+            .latency = latency,
+            .measured_at = QDateTime::currentMSecsSinceEpoch(),
+        });
+        size = m_pending_samples.size();
+    }
+
+    if (size >= LATENCY_FLUSH_SIZE) {
+        QMetaObject::invokeMethod(this, &DBTools::flushLatency,
+                                  Qt::QueuedConnection);
+    } else {
+        QMetaObject::invokeMethod(
+            &m_latency_timer,
+            [this] {
+                if (!m_latency_timer.isActive())
+                    m_latency_timer.start();
+            },
+            Qt::AutoConnection);
+    }
+}
 
+void DBTools::flushLatency() {
+    QHash<qint64, qint64> pending;
+    QList<LatencySample> samples;
+    {
+        QMutexLocker locker(&m_latency_mutex);
+        pending.swap(m_pending_latency);
+        samples.swap(m_pending_samples);
+    }
+
+    m_latency_timer.stop();
+    if (pending.isEmpty())
+        return;
+
+    // history lives in SQL only, the memory backend keeps the latest result
+    QList<DBStatement> statements;
+    if (m_backend != DBBackend::memory)
+        statements = historyStatements(pending, samples);
+
+    submit([storage = p_nodes, pending,
+            statements](DBConnection *connection) {
+        return connection->transaction([&]() -> QSqlError {
+            if (auto result = storage->updateLatency(connection, pending);
+                result.type() != QSqlError::NoError)
+                return result;
+
+            return batchError(connection->exec(statements, false));
+        });
+    }).then([this, nodes_id = pending.keys(),
+             logger = p_logger](const QSqlError &result) {
+        invalidateNodes(nodes_id);
+
+        if (result.type() != QSqlError::NoError)
+            logger->error("Failed to flush latency: {}",
+                          result.text().toStdString());
+    });
+}
+
+QList<DBStatement>
+DBTools::historyStatements(const QHash<qint64, qint64> &pending,
+                           const QList<LatencySample> &samples) {
+    QList<DBStatement> statements;
+    statements.reserve(pending.size() + samples.size());
+    for (auto &sample : samples) {
+        statements.append({
+            .sql = "INSERT INTO latency_history (NodeID, MeasuredAt, Latency, "
+                   "Failed) VALUES (?,?,?,?);",
+            .inputs = {sample.node_id, sample.measured_at, sample.latency,
+                       sample.latency < 0},
+        });
+    }
+
+    // history is a rolling window, trim it for the nodes just measured
+    auto expired_at = QDateTime::currentDateTime()
+                          .addDays(-LATENCY_HISTORY_DAYS)
+                          .toMSecsSinceEpoch();
+    for (auto iter = pending.cbegin(); iter != pending.cend(); ++iter) {
+        statements.append({
+            .sql = "DELETE FROM latency_history "
+                   "WHERE NodeID = ? AND MeasuredAt < ?;",
+            .inputs = {iter.key(), expired_at},
+        });
+    }
+
+    return statements;
+}
+
+QFuture<QList<LatencyStats>>
+DBTools::latencyStatsFromGroupID(qint64 group_id, int minutes) {
+    if (m_backend == DBBackend::memory) {
+        p_logger->error("Latency statistics are not supported by the {} "
+                        "backend",
+                        magic_enum::enum_name(m_backend));
+        return QtFuture::makeReadyFuture(QList<LatencyStats>());
+    }
+
+    const DBStatement statement = {
+        .sql = "SELECT NodeID, COUNT(*), SUM(Failed), "
+               "MIN(CASE WHEN Failed = 0 AND Position >= 0.50 * Succeeded "
+               "THEN Latency END), "
+               "MIN(CASE WHEN Failed = 0 AND Position >= 0.95 * Succeeded "
+               "THEN Latency END) "
+               "FROM (SELECT NodeID, Latency, Failed, "
+               "ROW_NUMBER() OVER (PARTITION BY NodeID, Failed "
+               "ORDER BY Latency) AS Position, "
+               "SUM(1 - Failed) OVER (PARTITION BY NodeID) AS Succeeded "
+               "FROM latency_history "
+               "WHERE NodeID IN (SELECT ID FROM nodes WHERE GroupID = ?) "
+               "AND MeasuredAt >= ?) "
+               "GROUP BY NodeID;",
+        .inputs = {group_id, QDateTime::currentDateTime()
+                                 .addSecs(-minutes * 60LL)
+                                 .toMSecsSinceEpoch()},
+        .output_columns = 5,
+    };
+
+    return read([statement, logger = p_logger](DBConnection *connection) {
+        QList<LatencyStats> stats;
+
+        auto result = connection->exec(statement);
+        if (result.error.type() != QSqlError::NoError) {
+            logger->error("Failed to query latency history");
+            return stats;
+        }
+
+        for (auto &item : result.rows) {
+            LatencyStats stat = {
+                .node_id = item.at(0).toLongLong(),
+                .samples = item.at(1).toLongLong(),
+                .failures = item.at(2).toLongLong(),
+                .p50 = item.at(3).isNull() ? -1 : item.at(3).toLongLong(),
+                .p95 = item.at(4).isNull() ? -1 : item.at(4).toLongLong(),
+            };
+
+            if (stat.samples > 0)
+                stat.loss_rate = double(stat.failures) / stat.samples;
+
+            stats.append(stat);
+        }
+
+        return stats;
+    });
+}
+
+DBStatement DBTools::insertStatement(GroupInfo &group) {
     if (group.created_time.isNull()) {
         group.created_time = QDateTime::currentDateTime();
     }
@@ -500,52 +2427,118 @@ QSqlError DBTools::insert(GroupInfo &group) {
         group.modified_time = QDateTime::currentDateTime();
     }
 
-    QVariantList input_collection = {
-        group.name,
-        group.is_subscription,
-        group.type,
-        group.url,
-        group.cycle_time,
-        group.created_time.toSecsSinceEpoch(),
-        group.modified_time.toSecsSinceEpoch(),
+    return {
+        .sql = "INSERT INTO groups "
+               "(Name, IsSubscription, Type, Url, CycleTime, CreatedAt, "
+               "ModifiedAt) VALUES(?,?,?,?,?,?,?)",
+        .inputs =
+            {
+                group.name,
+                group.is_subscription,
+                group.type,
+                group.url,
+                group.cycle_time,
+                group.created_time.toSecsSinceEpoch(),
+                group.modified_time.toSecsSinceEpoch(),
+            },
     };
+}
 
-    auto [result, id] = stepExec(insert_str, &input_collection);
-    group.id = id;
+QSqlError DBTools::insert(GroupInfo &group) {
+    auto result = submit(insertStatement(group)).result();
+    group.id = result.last_insert_id;
 
-    return result;
+    return result.error;
 }
 
-QSqlError DBTools::update(GroupInfo &group) {
-    QSqlError result;
-    const QString update_str("UPDATE groups SET "
-                             "Name = ?, IsSubscription = ?, Type = ?, "
-                             "Url = ?, CycleTime = ?, ModifiedAt = ? "
-                             "WHERE ID = ?;");
+QFuture<QPair<QSqlError, qint64>> DBTools::insertAsync(GroupInfo group) {
+    return submit(insertStatement(group)).then([](const DBResult &result) {
+        return qMakePair(result.error, result.last_insert_id);
+    });
+}
+
+DBStatement DBTools::updateStatement(GroupInfo &group) {
     group.modified_time = QDateTime::currentDateTime();
 
-    QVariantList input_collection = {
-        group.name,       group.is_subscription,
-        group.type,       group.url,
-        group.cycle_time, group.modified_time.toSecsSinceEpoch(),
-        group.id,
+    return {
+        .sql = "UPDATE groups SET "
+               "Name = ?, IsSubscription = ?, Type = ?, "
+               "Url = ?, CycleTime = ?, ModifiedAt = ? "
+               "WHERE ID = ?;",
+        .inputs =
+            {
+                group.name,
+                group.is_subscription,
+                group.type,
+                group.url,
+                group.cycle_time,
+                group.modified_time.toSecsSinceEpoch(),
+                group.id,
+            },
     };
+}
 
-    if (result = stepExec(update_str, &input_collection).first;
-        result.type() != QSqlError::NoError) {
+QFuture<QSqlError> DBTools::updateGroups(QList<GroupInfo> &groups) {
+    QList<DBStatement> statements;
+    statements.reserve(groups.size());
+    for (auto &group : groups)
+        statements.append(updateStatement(group));
+
+    return submit([storage = p_nodes, statements,
+                   groups](DBConnection *connection) {
+               return connection->transaction([&]() -> QSqlError {
+                   for (auto i = 0; i < groups.size(); ++i) {
+                       if (auto res = connection->exec(statements.at(i));
+                           res.error.type() != QSqlError::NoError)
+                           return res.error;
+
+                       if (auto res = storage->renameGroup(
+                               connection, groups.at(i).id,
+                               groups.at(i).name);
+                           res.type() != QSqlError::NoError)
+                           return res;
+                   }
+
+                   return {};
+               });
+           })
+        .then([this, groups](const QSqlError &result) {
+            for (auto &group : groups)
+                invalidateGroup(group.id);
+
+            return result;
+        });
+}
+
+QSqlError DBTools::update(GroupInfo &group) {
+    QList<GroupInfo> groups = {group};
+
+    auto result = updateGroups(groups).result();
+    if (result.type() != QSqlError::NoError)
         p_logger->error("Failed to update group: {}", group.id);
-    }
+    group.modified_time = groups.first().modified_time;
 
     return result;
 }
 
 QSqlError DBTools::update(QList<GroupInfo> &groups) {
-    QSqlError result;
-    TransactionWrap transactionWrap(this);
-    for (auto &group : groups)
-        if (result = update(group); result.type() != QSqlError::NoError)
-            break;
-    return result;
+    return updateGroups(groups).result();
+}
+
+QFuture<QSqlError> DBTools::updateAsync(GroupInfo group) {
+    QList<GroupInfo> groups = {group};
+
+    return updateGroups(groups).then(
+        [logger = p_logger, group_id = group.id](const QSqlError &result) {
+            if (result.type() != QSqlError::NoError)
+                logger->error("Failed to update group: {}", group_id);
+
+            return result;
+        });
+}
+
+QFuture<QSqlError> DBTools::updateAsync(QList<GroupInfo> groups) {
+    return updateGroups(groups);
 }
 
 QSqlError DBTools::insert(RoutingInfo &routing) {
@@ -604,52 +2597,142 @@ QSqlError DBTools::update(RoutingInfo &routing) {
 }
 
 QSqlError DBTools::removeNodeFromID(qint64 id) {
-    const QString remove_str("DELETE FROM nodes WHERE ID = ?");
-    QVariantList input_collection = {id};
+    auto result = submit([storage = p_nodes, id](DBConnection *connection) {
+                      return storage->remove(connection, {id});
+                  }).result();
+    invalidateNode(id);
 
-    return stepExec(remove_str, &input_collection).first;
+    return result;
 }
 
-QSqlError DBTools::removeGroupFromID(qint64 id, bool keep_group) {
-    QSqlError result;
-    QVariantList input_collection = {id};
+QFuture<QSqlError> DBTools::removeGroupFromID(qint64 id, bool keep_group) {
+    return submit([storage = p_nodes, id,
+                   keep_group](DBConnection *connection) {
+               return connection->transaction([&]() -> QSqlError {
+                   if (!keep_group) {
+                       if (auto res = connection->exec(DBStatement{
+                               .sql = "DELETE FROM groups WHERE ID = ?",
+                               .inputs = {id},
+                           });
+                           res.error.type() != QSqlError::NoError)
+                           return res.error;
+                   }
+
+                   return storage->removeGroup(connection, id);
+               });
+           })
+        .then([this, id](const QSqlError &result) {
+            invalidateGroup(id);
+
+            if (result.type() != QSqlError::NoError)
+                p_logger->error("Failed to remove group {}: {}", id,
+                                result.text().toStdString());
 
-    if (!keep_group) {
-        const QString remove_str("DELETE FROM groups WHERE ID = ?");
+            return result;
+        });
+}
 
-        if (result = stepExec(remove_str, &input_collection).first;
-            result.type() != QSqlError::NoError) {
-            p_logger->error("Failed to remove group {}: {}", id,
-                            result.text().toStdString());
+QFuture<QSqlError> DBTools::removeNodes(const QList<qint64> &nodes_id) {
+    return submit([storage = p_nodes, nodes_id](DBConnection *connection) {
+               return connection->transaction([&]() {
+                   return storage->remove(connection, nodes_id);
+               });
+           })
+        .then([this, nodes_id](const QSqlError &result) {
+            invalidateNodes(nodes_id);
+            return result;
+        });
+}
 
+QFuture<QSqlError> DBTools::moveNodes(const QList<qint64> &nodes_id,
+                                      qint64 group_id) {
+    return submit([storage = p_nodes, nodes_id,
+                   group_id](DBConnection *connection) {
+               return connection->transaction([&]() {
+                   return storage->move(connection, nodes_id, group_id);
+               });
+           })
+        .then([this, nodes_id](const QSqlError &result) {
+            invalidateNodes(nodes_id);
             return result;
-        }
-    }
+        });
+}
 
-    const QString remove_str("DELETE FROM nodes WHERE GroupID = ?");
-    if (result = stepExec(remove_str, &input_collection).first;
-        result.type() != QSqlError::NoError) {
-        p_logger->error("Failed to remove nodes: {}",
-                        result.text().toStdString());
-    }
+QFuture<QSqlError> DBTools::copyNodes(const QList<qint64> &nodes_id,
+                                      qint64 group_id) {
+    return submit([storage = p_nodes, nodes_id,
+                   group_id](DBConnection *connection) {
+        return connection->transaction([&]() {
+            return storage->copy(connection, nodes_id, group_id);
+        });
+    });
+}
 
-    return result;
+QFuture<QPair<QSqlError, QString>>
+DBTools::updateRouting(const QList<qint64> &nodes_id, qint64 routing_id) {
+    // 0 is the built-in routing new nodes start with, it has no row
+    const DBStatement name_statement = {
+        .sql = "SELECT IFNULL((SELECT Name FROM routings WHERE ID = ?), "
+               "'default_routings')",
+        .inputs = {routing_id},
+        .output_columns = 1,
+    };
+
+    return submit([this, storage = p_nodes, name_statement, nodes_id,
+                   routing_id](DBConnection *connection) {
+        auto result = connection->exec(name_statement);
+        if (result.error.type() != QSqlError::NoError ||
+            result.rows.isEmpty())
+            return qMakePair(result.error, QString());
+
+        auto routing_name = result.rows.first().first().toString();
+        auto error = connection->transaction([&]() {
+            return storage->setRouting(connection, nodes_id, routing_id,
+                                       routing_name);
+        });
+        invalidateNodes(nodes_id);
+        if (error.type() != QSqlError::NoError)
+            return qMakePair(error, QString());
+
+        return qMakePair(QSqlError(), routing_name);
+    });
 }
 
-qsizetype DBTools::getSizeFromGroupID(qint64 group_id) {
-    QList<QVariantList> collections;
-    QVariantList input_collection = {group_id};
-    const QString select_str("SELECT ID FROM nodes WHERE GroupID = ?");
+QList<DBStatement> DBTools::nodeSetStatements(const QString &sql,
+                                              const QVariantList &inputs,
+                                              const QList<qint64> &nodes_id) {
+    QList<DBStatement> statements;
+    for (qsizetype offset = 0; offset < nodes_id.size();
+         offset += NODE_SET_SIZE) {
+        auto size = std::min(NODE_SET_SIZE, nodes_id.size() - offset);
 
-    if (auto result =
-            stepExec(select_str, &input_collection, 1, &collections).first;
-        result.type() != QSqlError::NoError) {
-        p_logger->error("Failed to list all nodes");
-    } else {
-        return collections.size();
+        QStringList placeholders;
+        placeholders.fill("?", size);
+
+        DBStatement statement = {
+            .sql = sql.arg(placeholders.join(",")),
+            .inputs = inputs,
+        };
+        for (auto i = offset; i < offset + size; ++i)
+            statement.inputs.append(nodes_id.at(i));
+
+        statements.append(statement);
     }
 
-    return 0;
+    return statements;
+}
+
+QFuture<qsizetype> DBTools::getSizeFromGroupID(qint64 group_id) {
+    return read([storage = p_nodes, group_id,
+                 logger = p_logger](DBConnection *connection) -> qsizetype {
+        auto [error, size] = storage->size(connection, group_id);
+        if (error.type() != QSqlError::NoError) {
+            logger->error("Failed to read group size: {}", group_id);
+            return 0;
+        }
+
+        return size;
+    });
 }
 
 std::optional<GroupInfo> DBTools::getGroupFromID(qint64 group_id) {
@@ -662,60 +2745,238 @@ std::optional<GroupInfo> DBTools::getGroupFromID(qint64 group_id) {
     return {};
 }
 
-QSqlError DBTools::reloadAllGroupsInfo() {
-    QSqlError result;
-    GroupInfo temp;
-    const QString select_str("SELECT * FROM groups");
-    QList<QVariantList> collections;
+QFuture<QSqlError> DBTools::reloadAllGroupsInfo() {
+    // item counts come from the trigger maintained counters in the same query
+    const DBStatement statement = {
+        .sql = "SELECT groups.ID, Name, IsSubscription, Type, Url, CycleTime, "
+               "CreatedAt, ModifiedAt, IFNULL(group_counters.Items, 0) "
+               "FROM groups LEFT JOIN group_counters "
+               "ON group_counters.GroupID = groups.ID;",
+        .output_columns = 9,
+    };
 
-    if (result = stepExec(select_str, nullptr, 8, &collections).first;
-        result.type() != QSqlError::NoError) {
-        p_logger->error("Failed to list all groups");
-        return result;
-    }
+    // the memory storage counts its own nodes
+    auto rows = read([storage = p_nodes, statement,
+                      counted = m_backend == DBBackend::memory](
+                         DBConnection *connection) {
+        auto result = connection->exec(statement);
+        if (!counted)
+            return result;
 
-    m_groups.clear();
+        for (auto &item : result.rows)
+            item[8] =
+                storage->size(connection, item.at(0).toLongLong()).second;
 
-    for (auto &item : collections) {
-        GroupInfo group = {
-            .id = item.at(0).toLongLong(),
-            .name = item.at(1).toString(),
-            .is_subscription = item.at(2).toBool(),
-            .type =
-                magic_enum::enum_value<SubscriptionType>(item.at(3).toInt()),
-            .url = item.at(4).toString(),
-            .cycle_time = item.at(5).toInt(),
-            .created_time =
-                QDateTime::fromSecsSinceEpoch(item.at(6).toLongLong()),
-            .modified_time =
-                QDateTime::fromSecsSinceEpoch(item.at(7).toLongLong()),
-        };
+        return result;
+    });
 
-        group.items = getSizeFromGroupID(group.id);
+    return rows.then(this, [this](const DBResult &result) {
+        if (result.error.type() != QSqlError::NoError) {
+            p_logger->error("Failed to list all groups");
+            return result.error;
+        }
 
-        m_groups.emplace_back(group);
-    }
+        m_groups.clear();
+
+        for (auto &item : result.rows) {
+            GroupInfo group = {
+                .id = item.at(0).toLongLong(),
+                .name = item.at(1).toString(),
+                .is_subscription = item.at(2).toBool(),
+                .type = magic_enum::enum_value<SubscriptionType>(
+                    item.at(3).toInt()),
+                .url = item.at(4).toString(),
+                .cycle_time = item.at(5).toInt(),
+                .created_time =
+                    QDateTime::fromSecsSinceEpoch(item.at(6).toLongLong()),
+                .modified_time =
+                    QDateTime::fromSecsSinceEpoch(item.at(7).toLongLong()),
+                .items = item.at(8).toInt(),
+            };
+
+            m_groups.emplace_back(group);
+        }
 
-    return result;
+        return result.error;
+    });
 }
 
 QList<GroupInfo> DBTools::getAllGroupsInfo() { return m_groups; }
 
 QList<NodeInfo> DBTools::listAllNodesFromGroupID(qint64 group_id) {
-    QList<NodeInfo> nodes;
-    QList<QVariantList> collections;
-    QVariantList input_collection = {group_id};
-    const QString select_str("SELECT * FROM nodes WHERE GroupID = ?");
+    return listAllNodesFromGroupIDAsync(group_id).result();
+}
 
-    if (auto result =
-            stepExec(select_str, &input_collection, 17, &collections).first;
-        result.type() != QSqlError::NoError) {
+QFuture<QList<NodeInfo>>
+DBTools::listAllNodesFromGroupIDAsync(qint64 group_id) {
+    return read([storage = p_nodes, group_id,
+                 logger = p_logger](DBConnection *connection) {
+        auto [error, nodes] = storage->list(connection, group_id);
+        if (error.type() != QSqlError::NoError) {
+            logger->error("Failed to list all nodes");
+            return QList<NodeInfo>();
+        }
+
+        return nodes;
+    });
+}
+
+QList<NodeSummary> DBTools::listNodeSummariesFromGroupID(qint64 group_id) {
+    return listNodeSummariesFromGroupIDAsync(group_id).result();
+}
+
+QFuture<QList<NodeSummary>>
+DBTools::listNodeSummariesFromGroupIDAsync(qint64 group_id) {
+    return read([storage = p_nodes, group_id,
+                 logger = p_logger](DBConnection *connection) {
+        auto [error, nodes] = storage->summaries(connection, group_id, 0, -1);
+        if (error.type() != QSqlError::NoError) {
+            logger->error("Failed to list node summaries");
+            return QList<NodeSummary>();
+        }
+
+        return nodes;
+    });
+}
+
+QFuture<QList<NodeSummary>>
+DBTools::listNodeSummariesPage(qint64 group_id, qint64 after_id, int limit) {
+    return read([storage = p_nodes, group_id, after_id, limit,
+                 logger = p_logger](DBConnection *connection) {
+        auto [error, nodes] =
+            storage->summaries(connection, group_id, after_id, limit);
+        if (error.type() != QSqlError::NoError) {
+            logger->error("Failed to list node page");
+            return QList<NodeSummary>();
+        }
+
+        return nodes;
+    });
+}
 
-        p_logger->error("Failed to list all nodes");
+QFuture<QList<NodeSummary>>
+DBTools::listNodeSummariesFromIDs(const QList<qint64> &nodes_id) {
+    return read([storage = p_nodes, nodes_id,
+                 logger = p_logger](DBConnection *connection) {
+        if (nodes_id.isEmpty())
+            return QList<NodeSummary>();
+
+        auto [error, nodes] = storage->summaries(connection, nodes_id);
+        if (error.type() != QSqlError::NoError) {
+            logger->error("Failed to list nodes from id");
+            return QList<NodeSummary>();
+        }
 
         return nodes;
+    });
+}
+
+QFuture<qint64> DBTools::getNodeIndex(qint64 group_id, qint64 node_id) {
+    return read([storage = p_nodes, group_id, node_id,
+                 logger = p_logger](DBConnection *connection) -> qint64 {
+        auto [error, index] = storage->indexOf(connection, group_id, node_id);
+        if (error.type() != QSqlError::NoError) {
+            logger->error("Failed to locate node: {}", node_id);
+            return -1;
+        }
+
+        return index;
+    });
+}
+
+std::optional<NodeInfo> DBTools::getNodeByID(qint64 node_id) {
+    return getNodeByIDAsync(node_id).result();
+}
+
+QFuture<std::optional<NodeInfo>> DBTools::getNodeByIDAsync(qint64 node_id) {
+    quint64 generation;
+    {
+        QMutexLocker locker(&m_cache_mutex);
+        if (auto node = m_node_cache.object(node_id); node != nullptr)
+            return QtFuture::makeReadyFuture(std::optional<NodeInfo>(*node));
+
+        generation = m_cache_generation;
+    }
+
+    return read([storage = p_nodes, node_id](DBConnection *connection) {
+               return storage->get(connection, node_id);
+           })
+        .then([this, node_id,
+               generation](const QPair<QSqlError, std::optional<NodeInfo>>
+                               &result) -> std::optional<NodeInfo> {
+            if (result.first.type() != QSqlError::NoError) {
+                p_logger->error("Failed to load node: {}", node_id);
+                return {};
+            }
+
+            if (!result.second.has_value())
+                return {};
+
+            QMutexLocker locker(&m_cache_mutex);
+            if (generation == m_cache_generation)
+                m_node_cache.insert(node_id, new NodeInfo(*result.second));
+
+            return result.second;
+        });
+}
+
+void DBTools::invalidateNode(qint64 node_id) {
+    QMutexLocker locker(&m_cache_mutex);
+    ++m_cache_generation;
+    m_node_cache.remove(node_id);
+}
+
+void DBTools::invalidateNodes(const QList<qint64> &nodes_id) {
+    QMutexLocker locker(&m_cache_mutex);
+    ++m_cache_generation;
+    for (auto &node_id : nodes_id)
+        m_node_cache.remove(node_id);
+}
+
+void DBTools::invalidateGroup(qint64 group_id) {
+    QMutexLocker locker(&m_cache_mutex);
+    ++m_cache_generation;
+    for (auto &node_id : m_node_cache.keys()) {
+        if (auto node = m_node_cache.object(node_id);
+            node != nullptr && node->group_id == group_id)
+            m_node_cache.remove(node_id);
+    }
+}
+
+void DBTools::invalidateAllNodes() {
+    QMutexLocker locker(&m_cache_mutex);
+    ++m_cache_generation;
+    m_node_cache.clear();
+}
+
+QList<NodeSummary>
+DBTools::toNodeSummaries(const QList<QVariantList> &collections) {
+    QList<NodeSummary> nodes;
+    nodes.reserve(collections.size());
+
+    for (auto &item : collections) {
+        NodeSummary node = {
+            .id = item.at(0).toLongLong(),
+            .name = item.at(1).toString(),
+            .group_id = item.at(2).toLongLong(),
+            .protocol = magic_enum::enum_value<EntryType>(item.at(3).toInt()),
+            .address = item.at(4).toString(),
+            .port = item.at(5).toUInt(),
+            .latency = item.at(6).toLongLong(),
+            .routing_id = item.at(7).toLongLong(),
+            .routing_name = item.at(8).toString(),
+        };
+
+        nodes.emplace_back(node);
     }
 
+    return nodes;
+}
+
+QList<NodeInfo> DBTools::toNodes(const QList<QVariantList> &collections) {
+    QList<NodeInfo> nodes;
+    nodes.reserve(collections.size());
+
     for (auto &item : collections) {
         NodeInfo node = {
             .id = item.at(0).toLongLong(),
@@ -737,6 +2998,7 @@ QList<NodeInfo> DBTools::listAllNodesFromGroupID(qint64 group_id) {
                 QDateTime::fromSecsSinceEpoch(item.at(15).toLongLong()),
             .modified_time =
                 QDateTime::fromSecsSinceEpoch(item.at(16).toLongLong()),
+            .outbound = item.at(17).toByteArray(),
         };
 
         nodes.emplace_back(node);
@@ -745,37 +3007,337 @@ QList<NodeInfo> DBTools::listAllNodesFromGroupID(qint64 group_id) {
     return nodes;
 }
 
-QMap<qint64, QList<qint64>> DBTools::search(const QString &value) {
-    QList<QVariantList> collections;
-    QMap<qint64, QList<qint64>> search_results;
-    QVariantList input_collection = {value.toHtmlEscaped().append("*")};
-    const QString search_str(
-        "SELECT GroupID,GROUP_CONCAT(ID) FROM search WHERE "
-        "search = ? GROUP BY GroupID;");
+QFuture<QList<SearchResult>> DBTools::search(const QString &value,
+                                             int limit) {
+    if (m_backend == DBBackend::memory) {
+        p_logger->error("Search is not supported by the {} backend",
+                        magic_enum::enum_name(m_backend));
+        return QtFuture::makeReadyFuture(QList<SearchResult>());
+    }
 
-    if (auto result =
-            stepExec(search_str, &input_collection, 2, &collections).first;
-        result.type() != QSqlError::NoError) {
-        p_logger->error("Failed to list all nodes");
+    auto statement = searchStatement(value, limit);
 
-        return search_results;
+    quint64 serial;
+    {
+        // the running searches are stale from here on
+        QMutexLocker locker(&m_search_mutex);
+        serial = ++m_search_serial;
+        for (auto &connection : m_search_connections)
+            connection->interrupt();
     }
 
-    for (auto &item : collections) {
-        QList<qint64> nodes_id;
+    return read([this, serial, statement,
+                 logger = p_logger](DBConnection *connection) {
+        QList<SearchResult> results;
+        if (statement.sql.isEmpty())
+            return results;
+
+        {
+            // a newer keystroke superseded this search before it ran
+            QMutexLocker locker(&m_search_mutex);
+            if (serial != m_search_serial)
+                return results;
+
+            m_search_connections.append(connection);
+        }
+
+        auto result = connection->exec(statement);
+
+        {
+            QMutexLocker locker(&m_search_mutex);
+            m_search_connections.removeOne(connection);
+            if (serial != m_search_serial)
+                return results;
+        }
+
+        if (result.error.type() != QSqlError::NoError) {
+            logger->error("Failed to search nodes: {}",
+                          result.error.text().toStdString());
+            return results;
+        }
+
+        results.reserve(result.rows.size());
+        for (auto &row : result.rows) {
+            results.append({
+                .node_id = row.at(0).toLongLong(),
+                .group_id = row.at(1).toLongLong(),
+                .score = row.at(2).toDouble(),
+            });
+        }
+
+        return results;
+    });
+}
+
+DBStatement DBTools::searchStatement(const QString &value, int limit) {
+    DBStatement statement = {.output_columns = 3};
+
+    QStringList phrases;
+    QStringList filters;
+    QVariantList filter_inputs;
+    for (auto term : value.simplified().split(' ', Qt::SkipEmptyParts)) {
+        if (term.toUcs4().size() >= SEARCH_TRIGRAM) {
+            phrases.append(QString("\"%1\"").arg(term.replace("\"", "\"\"")));
+            continue;
+        }
+
+        auto pattern = QString("%%1%").arg(term.replace("\\", "\\\\")
+                                               .replace("%", "\\%")
+                                               .replace("_", "\\_"));
+        filters.append("(nodes.Name LIKE ? ESCAPE '\\' OR "
+                       "nodes.GroupName LIKE ? ESCAPE '\\' OR "
+                       "nodes.Address LIKE ? ESCAPE '\\')");
+        filter_inputs << pattern << pattern << pattern;
+    }
+
+    if (phrases.isEmpty() && filters.isEmpty())
+        return statement;
+
+    auto latency = QString("(CASE WHEN nodes.Latency > 0 THEN "
+                           "MIN(nodes.Latency, %1) ELSE %1 END) * %2 / 1000.0")
+                       .arg(SEARCH_LATENCY_CAP)
+                       .arg(SEARCH_LATENCY_WEIGHT);
+
+    if (phrases.isEmpty()) {
+        // a scan of nodes, stop at the first rows found and rank only those
+        statement.sql =
+            QString("SELECT ID, GroupID, Score FROM (SELECT nodes.ID, "
+                    "nodes.GroupID, %1 AS Score FROM nodes WHERE %2 "
+                    "LIMIT ?) AS nodes ")
+                .arg(latency, filters.join(" AND "));
+        filter_inputs.append(std::min(limit, SEARCH_SCAN_LIMIT));
+    } else {
+        // names weigh more than group names and addresses
+        filters.prepend("search MATCH ?");
+        statement.inputs.append(phrases.join(" "));
+        statement.sql =
+            QString("SELECT nodes.ID, nodes.GroupID, "
+                    "bm25(search, 10.0, 2.0, 1.0) + %1 AS Score FROM search "
+                    "JOIN nodes ON nodes.ID = search.rowid WHERE %2 ")
+                .arg(latency, filters.join(" AND "));
+    }
+
+    statement.sql.append("ORDER BY Score, nodes.ID LIMIT ?;");
+    statement.inputs.append(filter_inputs);
+    statement.inputs.append(limit);
+
+    return statement;
+}
+
+bool DBTools::isIdle() const {
+    return QDateTime::currentMSecsSinceEpoch() - m_last_write >=
+           MAINTENANCE_IDLE_TIME;
+}
+
+void DBTools::maintain() {
+    if (!m_is_open || m_is_maintaining || !isIdle())
+        return;
+
+    // a run interrupted by a write resumes where it stopped
+    if (m_maintenance_step != MaintenanceStep::done) {
+        runMaintenanceStep();
+        return;
+    }
+
+    m_is_maintaining = true;
+    post(&DBTools::storageStats)
+        .then(this, [this, serial = m_maintenance_serial](
+                        const DBResult &result) {
+            if (serial != m_maintenance_serial)
+                return;
+
+            m_is_maintaining = false;
+            if (result.error.type() != QSqlError::NoError ||
+                result.rows.isEmpty())
+                return;
+
+            auto changes = result.rows.first().at(0).toLongLong();
+            auto churn = changes - m_changes_baseline;
+            if (churn < MAINTENANCE_CHURN)
+                return;
+
+            p_logger->debug("Start maintenance after {} changed rows", churn);
+
+            m_maintenance = {.churn = churn};
+            m_size_before = result.rows.first().at(1).toLongLong();
+            m_maintenance_step = MaintenanceStep::optimize;
+            m_maintenance_clock.start();
+            runMaintenanceStep();
+        });
+}
+
+void DBTools::runMaintenanceStep() {
+    m_is_maintaining = true;
+    post([step = m_maintenance_step](DBConnection *connection) {
+        QElapsedTimer timer;
+        timer.start();
+        auto [error, has_more] = execMaintenanceStep(connection, step);
+        return std::make_tuple(error, has_more, timer.elapsed());
+    }).then(this, [this, serial = m_maintenance_serial](
+                      const std::tuple<QSqlError, bool, qint64> &result) {
+        if (serial != m_maintenance_serial)
+            return;
+
+        auto &[error, has_more, busy] = result;
+        m_is_maintaining = false;
+        m_maintenance.busy += busy;
+
+        if (error.type() != QSqlError::NoError) {
+            p_logger->error("Failed to run maintenance step {}: {}",
+                            magic_enum::enum_name(m_maintenance_step),
+                            error.text().toStdString());
+            m_maintenance_step = MaintenanceStep::done;
+            return;
+        }
+
+        if (!has_more)
+            m_maintenance_step = static_cast<MaintenanceStep>(
+                magic_enum::enum_integer(m_maintenance_step) + 1);
 
-        for (auto &node_id : item.at(1).toString().split(","))
-            nodes_id.append(node_id.toLongLong());
+        if (m_maintenance_step == MaintenanceStep::done) {
+            finishMaintenance();
+        } else if (isIdle()) {
+            runMaintenanceStep();
+        }
+    });
+}
+
+void DBTools::finishMaintenance() {
+    m_is_maintaining = true;
+    post(&DBTools::storageStats)
+        .then(this, [this, serial = m_maintenance_serial](
+                        const DBResult &result) {
+            if (serial != m_maintenance_serial)
+                return;
+
+            m_is_maintaining = false;
+            if (result.error.type() != QSqlError::NoError ||
+                result.rows.isEmpty())
+                return;
+
+            // the run's own writes do not count towards the next one
+            m_changes_baseline = result.rows.first().at(0).toLongLong();
+            m_maintenance.reclaimed =
+                m_size_before - result.rows.first().at(1).toLongLong();
+            m_maintenance.elapsed = m_maintenance_clock.elapsed();
+
+            p_logger->info("Maintenance reclaimed {} bytes, busy {} ms over "
+                           "{} ms",
+                           m_maintenance.reclaimed, m_maintenance.busy,
+                           m_maintenance.elapsed);
+            emit maintained(m_maintenance);
+        });
+}
+
+DBResult DBTools::storageStats(DBConnection *connection) {
+    return connection->exec({
+        .sql = "SELECT total_changes(), page_count * page_size "
+               "FROM pragma_page_count(), pragma_page_size();",
+        .output_columns = 2,
+    });
+}
+
+QPair<QSqlError, bool> DBTools::execMaintenanceStep(DBConnection *connection,
+                                                    MaintenanceStep step) {
+    switch (step) {
+    case MaintenanceStep::optimize: {
+        // the analysis limit keeps ANALYZE to a sample of each index
+        auto results = connection->exec(
+            {
+                {.sql = QString("PRAGMA analysis_limit = %1;")
+                            .arg(MAINTENANCE_ANALYSIS_LIMIT)},
+                {.sql = "PRAGMA optimize;"},
+            },
+            false);
+        return {batchError(results), false};
+    }
+    case MaintenanceStep::merge_search: {
+        // fts5 reports no work left when the merge changed less than two
+        // rows
+        const DBStatement changes = {.sql = "SELECT total_changes();",
+                                     .output_columns = 1};
+        auto before = connection->exec(changes);
+        auto merge = connection->exec({
+            .sql = "INSERT INTO search(search, rank) VALUES('merge', ?);",
+            .inputs = {MAINTENANCE_MERGE_PAGES},
+        });
+        auto after = connection->exec(changes);
+
+        for (auto &result : {before, merge, after}) {
+            if (result.error.type() != QSqlError::NoError)
+                return {result.error, false};
+        }
+
+        auto changed = after.rows.value(0).value(0).toLongLong() -
+                       before.rows.value(0).value(0).toLongLong();
+        return {{}, changed >= 2};
+    }
+    case MaintenanceStep::incremental_vacuum: {
+        const DBStatement mode = {.sql = "PRAGMA auto_vacuum;",
+                                  .output_columns = 1};
+        const DBStatement freelist = {.sql = "PRAGMA freelist_count;",
+                                      .output_columns = 1};
+
+        auto result = connection->exec({mode, freelist}, false);
+        if (auto error = batchError(result); error.type() != QSqlError::NoError)
+            return {error, false};
+
+        // databases created before auto_vacuum was set would need a full
+        // VACUUM to convert, which is not bounded, so they are left as is
+        auto pages = result.last().rows.value(0).value(0).toLongLong();
+        if (pages == 0 || result.first().rows.value(0).value(0).toInt() != 2)
+            return {{}, false};
+
+        // the pragma frees one page per step and the driver may step it only
+        // once, so repeat it until the budget is spent
+        const DBStatement vacuum = {
+            .sql = QString("PRAGMA incremental_vacuum(%1);")
+                       .arg(MAINTENANCE_VACUUM_PAGES)};
+        auto remaining = pages;
+        for (auto i = 0; i < MAINTENANCE_VACUUM_PAGES && remaining > 0 &&
+                         pages - remaining < MAINTENANCE_VACUUM_PAGES;
+             ++i) {
+            if (auto error = connection->exec(vacuum).error;
+                error.type() != QSqlError::NoError)
+                return {error, false};
+
+            auto count = connection->exec(freelist);
+            if (count.error.type() != QSqlError::NoError)
+                return {count.error, false};
+
+            remaining = count.rows.value(0).value(0).toLongLong();
+        }
 
-        search_results.insert(item.at(0).toLongLong(), nodes_id);
+        return {{}, remaining > 0};
+    }
+    case MaintenanceStep::done:
+        break;
     }
 
-    return search_results;
+    return {{}, false};
 }
 
 void DBTools::close() {
-    if (m_db.isOpen()) {
-        m_db.close();
+    if (m_is_open) {
+        // queued ahead of the close so buffered results are not lost
+        flushLatency();
+        invalidateAllNodes();
+
+        // total_changes() restarts with the next connection
+        m_maintenance_timer.stop();
+        m_maintenance_step = MaintenanceStep::done;
+        m_maintenance_serial++;
+        m_is_maintaining = false;
+        m_changes_baseline = 0;
+
+        // readers go first, the last connection to close checkpoints the
+        // WAL file and removes it
+        closeReadConnections();
+        submit([this](DBConnection *connection) {
+            connection->close();
+            m_memory_nodes.clear();
+        }).waitForFinished();
+        m_is_open = false;
         emit destroy();
     }
 }
@@ -801,7 +3363,7 @@ QVariantMap NodeInfo::toVariantMap() {
         {"address", this->address},
         {"port", this->port},
         {"password", this->password},
-        {"raw", this->raw},
+        {"raw", this->rawJson()},
         {"url", this->url},
         {"protocol", this->protocol},
         {"latency", this->latency},
@@ -812,6 +3374,14 @@ QVariantMap NodeInfo::toVariantMap() {
     };
 }
 
+QString NodeInfo::rawJson() const {
+    if (!raw.isEmpty() || outbound.isEmpty())
+        return raw;
+
+    return QString::fromStdString(SerializeTools::MessageToJson(
+        SerializeTools::BytesToOutbound(outbound)));
+}
+
 QVariantMap GroupInfo::toVariantMap() {
     auto type_name = magic_enum::enum_name(this->type);
 
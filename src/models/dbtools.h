@@ -3,16 +3,36 @@
 
 #include "../view_models/logtools.h"
 
+#include <QCache>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QFuture>
 #include <QMap>
 #include <QMutex>
+#include <QPromise>
+#include <QQueue>
+#include <QSemaphore>
 #include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QTimer>
+#include <QtConcurrent>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
 
 #include "magic_enum.hpp"
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+struct sqlite3;
+
 namespace across {
 enum SubscriptionType : int {
     base64 = 0,
@@ -29,6 +49,23 @@ enum EntryType : int {
     unknown,
 };
 
+// selected by Database.db_backend, sqlite3_memory opens ":memory:" on the
+// writer connection, memory keeps the nodes in a MemoryNodeStorage and the
+// other tables in ":memory:", both are discarded on close
+enum class DBBackend : int {
+    sqlite3,
+    sqlite3_memory,
+    memory,
+};
+
+// idle maintenance runs these in order, one bounded task at a time
+enum class MaintenanceStep : int {
+    optimize,
+    merge_search,
+    incremental_vacuum,
+    done,
+};
+
 struct NodeInfo {
     qint64 id = 0;
     QString name = "";
@@ -47,8 +84,31 @@ struct NodeInfo {
     qint64 download = 0;
     QDateTime created_time;
     QDateTime modified_time;
+    // serialized OutboundObject, raw is left empty when this is stored
+    QByteArray outbound;
 
     QVariantMap toVariantMap();
+    [[nodiscard]] QString rawJson() const;
+};
+
+// columns needed to draw a node row, Raw/URL are loaded by ID on demand
+struct NodeSummary {
+    qint64 id = 0;
+    QString name = "";
+    qint64 group_id = 0;
+    EntryType protocol = unknown;
+    QString address = "";
+    uint port = 0;
+    qint64 latency = -1;
+    qint64 routing_id = 0;
+    QString routing_name = "";
+};
+
+// lower scores rank first, bm25 weighted by the node latency
+struct SearchResult {
+    qint64 node_id = 0;
+    qint64 group_id = 0;
+    double score = 0.0;
 };
 
 struct GroupInfo {
@@ -65,6 +125,50 @@ struct GroupInfo {
     QVariantMap toVariantMap();
 };
 
+struct GroupSyncDelta {
+    qsizetype inserted = 0;
+    qsizetype updated = 0;
+    qsizetype removed = 0;
+    qsizetype unchanged = 0;
+};
+
+// a fresh listing matched against the stored rows of a group, indexes point
+// into the listing
+struct GroupSyncPlan {
+    QList<qsizetype> changed;
+    QList<qsizetype> fresh;
+    QList<qint64> removed;
+};
+
+struct NodeTraffic {
+    qint64 node_id = 0;
+    qint64 upload = 0;
+    qint64 download = 0;
+};
+
+struct LatencySample {
+    qint64 node_id = 0;
+    qint64 latency = -1;
+    qint64 measured_at = 0;
+};
+
+// percentiles use the nearest rank over successful samples only
+struct LatencyStats {
+    qint64 node_id = 0;
+    qsizetype samples = 0;
+    qsizetype failures = 0;
+    double loss_rate = 0.0;
+    qint64 p50 = -1;
+    qint64 p95 = -1;
+};
+
+struct MaintenanceReport {
+    qint64 churn = 0;
+    qint64 reclaimed = 0;
+    qint64 busy = 0;
+    qint64 elapsed = 0;
+};
+
 struct RoutingInfo {
     qint64 id = 0;
     QString name = "";
@@ -94,21 +198,260 @@ struct RuntimeValue {
     RuntimeValue(QString key, int type, const QVariant &value);
 };
 
+struct DBStatement {
+    QString sql;
+    QVariantList inputs;
+    int output_columns = 0;
+};
+
+struct DBResult {
+    QSqlError error;
+    qint64 last_insert_id = 0;
+    QList<QVariantList> rows;
+};
+
+class DBConnection;
+
+// an ordered schema change, statements run first and then the optional step,
+// both inside the transaction that records the version
+struct DBMigration {
+    int version = 0;
+    QString description = "";
+    QList<DBStatement> statements;
+    std::function<QSqlError(DBConnection *connection)> step = nullptr;
+};
+
+struct StatementCacheStats {
+    qint64 hits = 0;
+    qint64 misses = 0;
+    qsizetype size = 0;
+};
+
+// LRU cache of prepared queries keyed by SQL text, bound to one connection
+class StatementCache {
+  public:
+    explicit StatementCache(qsizetype capacity = 64);
+
+    QSqlQuery *acquire(QSqlDatabase &db, const QString &sql,
+                       QSqlError &error);
+    void release(const QString &sql);
+    void clear();
+
+    [[nodiscard]] StatementCacheStats stats() const;
+
+  private:
+    struct Entry {
+        std::shared_ptr<QSqlQuery> query;
+        quint64 last_used = 0;
+    };
+
+    void evict();
+
+    qsizetype m_capacity;
+    quint64 m_clock = 0;
+    QHash<QString, Entry> m_entries;
+    StatementCacheStats m_stats;
+};
+
+// a named QSQLITE connection, only usable from the thread that opened it
+class DBConnection {
+  public:
+    DBConnection(QString name, bool read_only);
+
+    ~DBConnection();
+
+    void setLogger(const std::shared_ptr<spdlog::logger> &logger);
+    bool open(const QString &db_path);
+    void close();
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] QString path() const;
+    QSqlDatabase &database();
+
+    DBResult exec(const DBStatement &statement);
+    QList<DBResult> exec(const QList<DBStatement> &statements,
+                         bool transaction = true);
+
+    // runs body inside a transaction, rolling back on error
+    QSqlError transaction(const std::function<QSqlError()> &body);
+
+    // callable from any thread while the connection is open, the running
+    // statement fails with an interrupt error
+    void interrupt();
+
+    [[nodiscard]] StatementCacheStats cacheStats() const;
+
+  private:
+    const QString m_name;
+    const bool m_read_only;
+    QSqlDatabase m_db;
+    sqlite3 *p_handle = nullptr;
+    StatementCache m_cache;
+    std::shared_ptr<spdlog::logger> p_logger;
+};
+
+// owns the single writer connection
 class DBWorker : public QObject {
     Q_OBJECT
   public:
+    using Task = std::function<void(DBConnection *connection)>;
+
     explicit DBWorker(QObject *parent = nullptr);
 
+    // thread-safe, tasks are executed in order on the worker thread
+    void enqueue(Task task);
+
   public slots:
-    void directExec(const QString &sql_str, QSqlDatabase &db);
+    void drain();
 
-    void stepExec(const QString &sql_str, QVariantList *inputCollection,
-                  int outputColumns, QList<QVariantList> *outputCollections,
-                  const std::shared_ptr<spdlog::logger>& p_logger, QSqlDatabase &db);
+  private:
+    QMutex m_mutex;
+    QQueue<Task> m_tasks;
+    bool m_is_scheduled = false;
 
-  signals:
-    void directExecReady(QSqlError result);
-    void stepExecReady(QPair<QSqlError, qint64> result);
+    DBConnection m_connection;
+};
+
+// node rows behind DBTools, called with the connection of the calling
+// thread, calls touching several rows do not open a transaction of their own
+class NodeStorage {
+  public:
+    virtual ~NodeStorage() = default;
+
+    // assigns node.id
+    virtual QSqlError insert(DBConnection *connection, NodeInfo &node) = 0;
+    virtual QSqlError update(DBConnection *connection, NodeInfo &node) = 0;
+    virtual QSqlError remove(DBConnection *connection,
+                             const QList<qint64> &nodes_id) = 0;
+    virtual QSqlError removeGroup(DBConnection *connection,
+                                  qint64 group_id) = 0;
+    virtual QSqlError renameGroup(DBConnection *connection, qint64 group_id,
+                                  const QString &name) = 0;
+    // the group name comes from the groups table, copies start without
+    // traffic
+    virtual QSqlError move(DBConnection *connection,
+                           const QList<qint64> &nodes_id, qint64 group_id) = 0;
+    virtual QSqlError copy(DBConnection *connection,
+                           const QList<qint64> &nodes_id, qint64 group_id) = 0;
+    virtual QSqlError setRouting(DBConnection *connection,
+                                 const QList<qint64> &nodes_id,
+                                 qint64 routing_id,
+                                 const QString &routing_name) = 0;
+    virtual QSqlError updateLatency(DBConnection *connection,
+                                    const QHash<qint64, qint64> &latencies) = 0;
+    virtual QSqlError addTraffic(DBConnection *connection,
+                                 const QList<NodeTraffic> &traffics) = 0;
+
+    virtual QPair<QSqlError, std::optional<NodeInfo>>
+    get(DBConnection *connection, qint64 node_id) = 0;
+    virtual QPair<QSqlError, QList<NodeInfo>> list(DBConnection *connection,
+                                                   qint64 group_id) = 0;
+    // ID order after after_id, a negative limit lists the rest of the group
+    virtual QPair<QSqlError, QList<NodeSummary>>
+    summaries(DBConnection *connection, qint64 group_id, qint64 after_id,
+              int limit) = 0;
+    virtual QPair<QSqlError, QList<NodeSummary>>
+    summaries(DBConnection *connection, const QList<qint64> &nodes_id) = 0;
+    virtual QPair<QSqlError, qsizetype> size(DBConnection *connection,
+                                             qint64 group_id) = 0;
+    // position of the node in its group by ID, -1 when it is not there
+    virtual QPair<QSqlError, qint64>
+    indexOf(DBConnection *connection, qint64 group_id, qint64 node_id) = 0;
+};
+
+// the nodes table
+class SQLiteNodeStorage : public NodeStorage {
+  public:
+    QSqlError insert(DBConnection *connection, NodeInfo &node) override;
+    QSqlError update(DBConnection *connection, NodeInfo &node) override;
+    QSqlError remove(DBConnection *connection,
+                     const QList<qint64> &nodes_id) override;
+    QSqlError removeGroup(DBConnection *connection, qint64 group_id) override;
+    QSqlError renameGroup(DBConnection *connection, qint64 group_id,
+                          const QString &name) override;
+    QSqlError move(DBConnection *connection, const QList<qint64> &nodes_id,
+                   qint64 group_id) override;
+    QSqlError copy(DBConnection *connection, const QList<qint64> &nodes_id,
+                   qint64 group_id) override;
+    QSqlError setRouting(DBConnection *connection,
+                         const QList<qint64> &nodes_id, qint64 routing_id,
+                         const QString &routing_name) override;
+    QSqlError updateLatency(DBConnection *connection,
+                            const QHash<qint64, qint64> &latencies) override;
+    QSqlError addTraffic(DBConnection *connection,
+                         const QList<NodeTraffic> &traffics) override;
+
+    QPair<QSqlError, std::optional<NodeInfo>> get(DBConnection *connection,
+                                                  qint64 node_id) override;
+    QPair<QSqlError, QList<NodeInfo>> list(DBConnection *connection,
+                                           qint64 group_id) override;
+    QPair<QSqlError, QList<NodeSummary>> summaries(DBConnection *connection,
+                                                   qint64 group_id,
+                                                   qint64 after_id,
+                                                   int limit) override;
+    QPair<QSqlError, QList<NodeSummary>>
+    summaries(DBConnection *connection,
+              const QList<qint64> &nodes_id) override;
+    QPair<QSqlError, qsizetype> size(DBConnection *connection,
+                                     qint64 group_id) override;
+    QPair<QSqlError, qint64> indexOf(DBConnection *connection,
+                                     qint64 group_id,
+                                     qint64 node_id) override;
+};
+
+// nodes in a hash map with an ID sorted index per group, only used on the
+// writer thread, nothing is written to the connection and a rolled back
+// transaction does not undo changes made here
+class MemoryNodeStorage : public NodeStorage {
+  public:
+    QSqlError insert(DBConnection *connection, NodeInfo &node) override;
+    QSqlError update(DBConnection *connection, NodeInfo &node) override;
+    QSqlError remove(DBConnection *connection,
+                     const QList<qint64> &nodes_id) override;
+    QSqlError removeGroup(DBConnection *connection, qint64 group_id) override;
+    QSqlError renameGroup(DBConnection *connection, qint64 group_id,
+                          const QString &name) override;
+    QSqlError move(DBConnection *connection, const QList<qint64> &nodes_id,
+                   qint64 group_id) override;
+    QSqlError copy(DBConnection *connection, const QList<qint64> &nodes_id,
+                   qint64 group_id) override;
+    QSqlError setRouting(DBConnection *connection,
+                         const QList<qint64> &nodes_id, qint64 routing_id,
+                         const QString &routing_name) override;
+    QSqlError updateLatency(DBConnection *connection,
+                            const QHash<qint64, qint64> &latencies) override;
+    QSqlError addTraffic(DBConnection *connection,
+                         const QList<NodeTraffic> &traffics) override;
+
+    QPair<QSqlError, std::optional<NodeInfo>> get(DBConnection *connection,
+                                                  qint64 node_id) override;
+    QPair<QSqlError, QList<NodeInfo>> list(DBConnection *connection,
+                                           qint64 group_id) override;
+    QPair<QSqlError, QList<NodeSummary>> summaries(DBConnection *connection,
+                                                   qint64 group_id,
+                                                   qint64 after_id,
+                                                   int limit) override;
+    QPair<QSqlError, QList<NodeSummary>>
+    summaries(DBConnection *connection,
+              const QList<qint64> &nodes_id) override;
+    QPair<QSqlError, qsizetype> size(DBConnection *connection,
+                                     qint64 group_id) override;
+    QPair<QSqlError, qint64> indexOf(DBConnection *connection,
+                                     qint64 group_id,
+                                     qint64 node_id) override;
+
+    // rows in the layout of DBTools::syncSnapshotStatement
+    QList<QVariantList> snapshot(qint64 group_id) const;
+    void clear();
+
+  private:
+    static QPair<QSqlError, QString> groupName(DBConnection *connection,
+                                               qint64 group_id);
+    void index(const NodeInfo &node);
+    void unindex(const NodeInfo &node);
+
+    QHash<qint64, NodeInfo> m_nodes;
+    QHash<qint64, QList<qint64>> m_groups;
+    qint64 m_last_id = 0;
 };
 
 class DBTools : public QObject {
@@ -119,64 +462,149 @@ class DBTools : public QObject {
 
     ~DBTools() override;
 
-    void init(const QString &db_path);
+    void init(const QString &db_path, const QString &db_backend = "sqlite3");
     void reload();
     bool isTableExists(const QString &table_name);
     bool isItemExists(const QString &group_name,
                       const QString &table_name = "groups");
 
     QSqlError createDefaultTables();
+    QSqlError migrate();
     QSqlError createDefaultValues();
     QSqlError createDefaultGroup();
     QSqlError createDefaultRouting();
 
+    // the calls returning a plain value wait for the database, they are
+    // left for startup and for QML getters, the GUI goes through futures
     QSqlError insert(NodeInfo &node);
     QSqlError insert(QList<NodeInfo> &nodes);
+    QFuture<QSqlError> insertAsync(NodeInfo node);
+    QFuture<QSqlError> bulkInsert(QList<NodeInfo> nodes);
+    // reconciles the group with a fresh subscription listing, matched nodes
+    // keep their ID, latency and traffic
+    QFuture<QPair<QSqlError, GroupSyncDelta>>
+    syncGroup(qint64 group_id, QList<NodeInfo> nodes);
+    // same result as syncGroup, but the listing is matched on the read pool
+    // and staged in a temporary table, the group only changes in one short
+    // transaction at the end
+    QFuture<QPair<QSqlError, GroupSyncDelta>>
+    importGroup(qint64 group_id, QList<NodeInfo> nodes);
     QSqlError update(NodeInfo &node);
     QSqlError update(QList<NodeInfo> &nodes);
+    QFuture<QSqlError> updateAsync(NodeInfo node);
+    // column-only updates, they leave the search index untouched
+    QFuture<QSqlError> updateLatency(qint64 node_id, qint64 latency);
+    QFuture<QSqlError> updateLatency(const QHash<qint64, qint64> &latencies);
+    // traffic is accumulated, upload and download are deltas
+    QFuture<QSqlError> updateTraffic(const NodeTraffic &traffic);
+    QFuture<QSqlError> updateTraffic(const QList<NodeTraffic> &traffics);
+    // write-behind, results are coalesced per node and written in one
+    // transaction on a timer or once the buffer is full
+    void queueLatency(qint64 node_id, qint64 latency);
+    // per node statistics of the samples taken in the last minutes, the
+    // memory backend keeps no history and resolves to an empty list
+    QFuture<QList<LatencyStats>> latencyStatsFromGroupID(qint64 group_id,
+                                                         int minutes);
 
     QSqlError insert(GroupInfo &group);
+    // resolves to the error and the ID of the new group
+    QFuture<QPair<QSqlError, qint64>> insertAsync(GroupInfo group);
     QSqlError update(GroupInfo &group);
     QSqlError update(QList<GroupInfo> &groups);
+    QFuture<QSqlError> updateAsync(GroupInfo group);
+    QFuture<QSqlError> updateAsync(QList<GroupInfo> groups);
 
     QSqlError insert(RoutingInfo &routing);
     QSqlError update(RoutingInfo &routing);
 
     QSqlError removeNodeFromID(qint64 id);
-    QSqlError removeGroupFromID(qint64 id, bool keep_group = false);
-    QSqlError reloadAllGroupsInfo();
+    QFuture<QSqlError> removeGroupFromID(qint64 id, bool keep_group = false);
+    // row-set operations, each call is a single transaction
+    QFuture<QSqlError> removeNodes(const QList<qint64> &nodes_id);
+    QFuture<QSqlError> moveNodes(const QList<qint64> &nodes_id,
+                                 qint64 group_id);
+    QFuture<QSqlError> copyNodes(const QList<qint64> &nodes_id,
+                                 qint64 group_id);
+    // resolves to the error and the routing name the nodes now carry
+    QFuture<QPair<QSqlError, QString>>
+    updateRouting(const QList<qint64> &nodes_id, qint64 routing_id);
+    // the cached groups are replaced on the thread of DBTools
+    QFuture<QSqlError> reloadAllGroupsInfo();
 
     QSqlError createRuntimeValue(const RuntimeValue &value);
     std::optional<RuntimeValue> readRuntimeValue(const QString &key);
     std::optional<RuntimeValue> readRuntimeValue(const RunTimeValues &key);
-    QSqlError updateRuntimeValue(const RuntimeValue &value);
+    QFuture<QSqlError> updateRuntimeValue(const RuntimeValue &value);
     QSqlError deleteRuntimeValue(const QString &key);
     QSqlError deleteRuntimeValue(const RunTimeValues &key);
+    // resets DEFAULT_NODE_ID once the node it points to is gone
+    QFuture<QSqlError> clearMissingDefaultNode();
 
     qint64 getCurrentNodeID();
     qint64 getCurrentGroupID();
     qint64 getDefaultNodeID();
     qint64 getDefaultGroupID();
-    qsizetype getSizeFromGroupID(qint64 group_id);
+    QFuture<qsizetype> getSizeFromGroupID(qint64 group_id);
     std::optional<GroupInfo> getGroupFromID(qint64 group_id);
     QList<GroupInfo> getAllGroupsInfo();
     QList<NodeInfo> listAllNodesFromGroupID(qint64 group_id);
-    QMap<qint64, QList<qint64>> search(const QString &value);
+    QFuture<QList<NodeInfo>> listAllNodesFromGroupIDAsync(qint64 group_id);
+    QList<NodeSummary> listNodeSummariesFromGroupID(qint64 group_id);
+    QFuture<QList<NodeSummary>>
+    listNodeSummariesFromGroupIDAsync(qint64 group_id);
+    // keyset paging in ID order, pass the last ID of the previous page
+    QFuture<QList<NodeSummary>> listNodeSummariesPage(qint64 group_id,
+                                                      qint64 after_id,
+                                                      int limit);
+    QFuture<QList<NodeSummary>>
+    listNodeSummariesFromIDs(const QList<qint64> &nodes_id);
+    // resolves to -1 when the node is not in the group
+    QFuture<qint64> getNodeIndex(qint64 group_id, qint64 node_id);
+    // served from an ID keyed cache, every node write invalidates it
+    std::optional<NodeInfo> getNodeByID(qint64 node_id);
+    QFuture<std::optional<NodeInfo>> getNodeByIDAsync(qint64 node_id);
+    // runs on the read pool, starting a search skips the queries of the
+    // previous ones that have not run yet and interrupts the running ones,
+    // the memory backend has no index and resolves to an empty list
+    QFuture<QList<SearchResult>> search(const QString &value,
+                                        int limit = SEARCH_LIMIT);
+
+    // asynchronous command queue, the returned future is fulfilled on the
+    // database thread
+    QFuture<DBResult> submit(const DBStatement &statement);
+    QFuture<QList<DBResult>> submit(const QList<DBStatement> &statements,
+                                    bool transaction = true);
+
+    template <typename Func>
+    auto submit(Func &&func)
+        -> QFuture<std::invoke_result_t<Func, DBConnection *>>;
+
+    // runs on the read pool, every pool thread owns a read-only connection
+    // so reads are not serialized behind the writer
+    QFuture<DBResult> read(const DBStatement &statement);
+
+    template <typename Func>
+    auto read(Func &&func)
+        -> QFuture<std::invoke_result_t<Func, DBConnection *>>;
+
+    static QSqlError batchError(const QList<DBResult> &results);
+
+    StatementCacheStats statementCacheStats();
 
   public slots:
+    void flushLatency();
+    // called on a timer, advances the idle maintenance by one step
+    void maintain();
     void close();
 
   signals:
-    void startDirectExec(const QString &sql_str, QSqlDatabase &db);
-    void startStepExec(const QString &sql_str, QVariantList *inputCollection,
-                       int outputColumns,
-                       QList<QVariantList> *outputCollections,
-                       std::shared_ptr<spdlog::logger> p_logger,
-                       QSqlDatabase &db);
-
     void destroy();
+    void maintained(const MaintenanceReport &report);
 
   private:
+    friend class SQLiteNodeStorage;
+    friend class MemoryNodeStorage;
+
     QSqlError directExec(const QString &sql_str);
 
     QPair<QSqlError, qint64>
@@ -184,38 +612,282 @@ class DBTools : public QObject {
              int outputColumns = 0,
              QList<QVariantList> *outputCollections = nullptr);
 
+    static void compactOutbound(NodeInfo &node);
+    static QVariantList insertValues(NodeInfo &node);
+    static DBStatement insertStatement(NodeInfo &node);
+    static DBStatement insertStatement(GroupInfo &group);
+    static DBStatement latencyStatement(qint64 node_id, qint64 latency);
+    static DBStatement trafficStatement(const NodeTraffic &traffic);
+    static QList<DBStatement>
+    historyStatements(const QHash<qint64, qint64> &pending,
+                      const QList<LatencySample> &samples);
+    static QList<DBStatement> bulkInsertStatements(QList<NodeInfo> &nodes);
+    static QPair<QSqlError, qint64>
+    execBulkInsert(DBConnection *connection,
+                   const QList<DBStatement> &statements);
+    static QPair<QSqlError, qint64>
+    insertRows(DBConnection *connection, const QList<DBStatement> &statements);
+    static QSqlError execSyncGroup(DBConnection *connection, qint64 group_id,
+                                   QList<NodeInfo> &nodes,
+                                   GroupSyncDelta &delta);
+    static DBStatement syncSnapshotStatement(qint64 group_id);
+    static QList<qint64> syncSnapshotToken(const QList<QVariantList> &rows);
+    static GroupSyncPlan planSync(const QList<QVariantList> &rows,
+                                  QList<NodeInfo> &nodes,
+                                  GroupSyncDelta &delta);
+    static QList<DBStatement> stagingStatements(qint64 batch,
+                                                QList<NodeInfo> &nodes,
+                                                const GroupSyncPlan &plan);
+    static QSqlError execImportGroup(DBConnection *connection, qint64 group_id,
+                                     qint64 batch,
+                                     const QList<DBStatement> &staging,
+                                     const QList<qint64> &token);
+    static QString fingerprint(EntryType protocol, const QString &address,
+                               uint port, const QString &password);
+    static DBStatement searchStatement(const QString &value, int limit);
+    static QList<DBStatement> nodeSetStatements(const QString &sql,
+                                                const QVariantList &inputs,
+                                                const QList<qint64> &nodes_id);
+    static DBStatement updateStatement(NodeInfo &node);
+    static DBStatement updateStatement(GroupInfo &group);
+    // the group rows and the group name their nodes carry
+    QFuture<QSqlError> updateGroups(QList<GroupInfo> &groups);
+    static QSqlError insertNodes(NodeStorage *storage,
+                                 DBConnection *connection,
+                                 QList<NodeInfo> &nodes);
+    static QSqlError syncMemoryGroup(MemoryNodeStorage &storage,
+                                     DBConnection *connection,
+                                     qint64 group_id, QList<NodeInfo> &nodes,
+                                     GroupSyncDelta &delta);
+    static QList<NodeInfo> toNodes(const QList<QVariantList> &collections);
+    static QList<NodeSummary>
+    toNodeSummaries(const QList<QVariantList> &collections);
+
+    DBConnection *readConnection(const QString &db_path);
+    // closes the connection of every pool thread on that thread
+    void closeReadConnections();
+
+    void invalidateNode(qint64 node_id);
+    void invalidateNodes(const QList<qint64> &nodes_id);
+    void invalidateGroup(qint64 group_id);
+    void invalidateAllNodes();
+
+    // same as submit but not counted as activity, so idle maintenance does
+    // not keep itself busy
+    template <typename Func>
+    auto post(Func &&func)
+        -> QFuture<std::invoke_result_t<Func, DBConnection *>>;
+
+    bool isIdle() const;
+    void runMaintenanceStep();
+    void finishMaintenance();
+    static DBResult storageStats(DBConnection *connection);
+    static QPair<QSqlError, bool>
+    execMaintenanceStep(DBConnection *connection, MaintenanceStep step);
+
+    static QList<DBMigration> migrations();
+    static QSqlError execMigration(DBConnection *connection,
+                                   const DBMigration &migration);
+
   private:
-    friend class TransactionWrap;
+    // the current schema for createDefaultTables, migrations keep their own
+    // copy of the SQL they shipped with
+
+    // external content, the index reads its columns back from nodes so the
+    // text is not stored twice, trigrams allow substring matches
+    static inline const QString SEARCH_TABLE =
+        "CREATE VIRTUAL TABLE IF NOT EXISTS search "
+        "USING fts5(Name, GroupName, Address, content='nodes', "
+        "content_rowid='ID', tokenize='trigram');";
+
+    // bulk inserts suspend the insert trigger and back-fill the index once,
+    // flipping a row keeps the prepared statements valid where DDL would not
+    static inline const QString SEARCH_STATE_TABLE =
+        "CREATE TABLE IF NOT EXISTS search_state("
+        "ID INTEGER PRIMARY KEY CHECK (ID = 1),"
+        "Suspended BOOLEAN NOT NULL DEFAULT 0);";
+
+    static inline const QString SEARCH_STATE_ROW =
+        "INSERT OR IGNORE INTO search_state (ID) VALUES (1);";
+
+    static inline const QString SEARCH_SUSPEND =
+        "UPDATE search_state SET Suspended = 1;";
+
+    static inline const QString SEARCH_RESUME =
+        "UPDATE search_state SET Suspended = 0;";
+
+    static inline const QString SEARCH_INSERT_TRIGGER =
+        "CREATE TRIGGER IF NOT EXISTS search_a_i AFTER INSERT ON nodes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_state WHERE Suspended = 1) "
+        "BEGIN "
+        "INSERT INTO search (rowid, Name, GroupName, Address) "
+        "VALUES (new.ID, new.Name, new.GroupName, new.Address); "
+        "END;";
+
+    // the delete command needs the values that were indexed
+    static inline const QString SEARCH_DELETE_TRIGGER =
+        "CREATE TRIGGER IF NOT EXISTS search_a_d AFTER DELETE ON nodes BEGIN "
+        "INSERT INTO search (search, rowid, Name, GroupName, Address) "
+        "VALUES ('delete', old.ID, old.Name, old.GroupName, old.Address); "
+        "END;";
+
+    // only fires when a searchable column really changed
+    static inline const QString SEARCH_UPDATE_TRIGGER =
+        "CREATE TRIGGER IF NOT EXISTS search_a_u "
+        "AFTER UPDATE OF Name, GroupName, Address ON nodes "
+        "WHEN new.Name IS NOT old.Name OR "
+        "new.GroupName IS NOT old.GroupName OR "
+        "new.Address IS NOT old.Address BEGIN "
+        "INSERT INTO search (search, rowid, Name, GroupName, Address) "
+        "VALUES ('delete', old.ID, old.Name, old.GroupName, old.Address); "
+        "INSERT INTO search (rowid, Name, GroupName, Address) "
+        "VALUES (new.ID, new.Name, new.GroupName, new.Address); "
+        "END;";
+
+    static inline const QString NODE_COLUMNS =
+        "ID, Name, GroupID, GroupName, RoutingID, RoutingName, Protocol, "
+        "Address, Port, Password, Raw, URL, Latency, Upload, Download, "
+        "CreatedAt, ModifiedAt, Outbound";
+
+    // 17 columns per row keeps a full chunk below SQLITE_MAX_VARIABLE_NUMBER
+    static constexpr qsizetype NODE_INSERT_COLUMNS = 17;
+    static constexpr qsizetype BULK_INSERT_ROWS = 58;
+    // IDs bound per statement of a row-set operation
+    static constexpr qsizetype NODE_SET_SIZE = 900;
+    // staged rows carry the batch and the matched node ID as well
+    static constexpr qsizetype STAGING_ROWS = 52;
+
+    // temporary tables live on the writer connection only, concurrent
+    // imports are told apart by their batch
+    static inline const QStringList STAGING_TABLES = {
+        "CREATE TEMP TABLE IF NOT EXISTS nodes_staging("
+        "Position INTEGER PRIMARY KEY,"
+        "Batch INTEGER NOT NULL,"
+        "NodeID INTEGER,"
+        "Name TEXT, GroupID INTEGER, GroupName TEXT, RoutingID INTEGER,"
+        "RoutingName TEXT, Protocol INTEGER, Address TEXT, Port INTEGER,"
+        "Password TEXT, Raw TEXT, URL TEXT, Latency INTEGER, Upload INT64,"
+        "Download INT64, CreatedAt INT64, ModifiedAt INT64, Outbound BLOB);",
+        "CREATE TEMP TABLE IF NOT EXISTS nodes_staging_removed("
+        "Batch INTEGER NOT NULL,"
+        "ID INTEGER NOT NULL);",
+    };
 
-    QSqlDatabase m_db;
     QList<GroupInfo> m_groups;
 
-    QThread *p_db_thread = nullptr;
+    // terms shorter than a trigram fall back to LIKE, without a longer term
+    // to match in the index they stop at SEARCH_SCAN_LIMIT rows, latency in
+    // ms is capped and added to the bm25 score
+    static constexpr int SEARCH_LIMIT = 1000;
+    static constexpr int SEARCH_SCAN_LIMIT = 100;
+    static constexpr qsizetype SEARCH_TRIGRAM = 3;
+    static constexpr qint64 SEARCH_LATENCY_CAP = 2000;
+    static constexpr double SEARCH_LATENCY_WEIGHT = 0.5;
+
+    std::atomic<quint64> m_search_serial = 0;
+    QMutex m_search_mutex;
+    QList<DBConnection *> m_search_connections;
+    std::atomic<qint64> m_import_batch = 0;
+
+    static constexpr int READ_CONNECTIONS = 4;
+    static inline const QString MEMORY_DB_PATH = ":memory:";
+    static constexpr int LATENCY_FLUSH_INTERVAL = 1000;
+    static constexpr qsizetype LATENCY_FLUSH_SIZE = 256;
+
+    static constexpr qint64 LATENCY_HISTORY_DAYS = 7;
+    static constexpr qsizetype NODE_CACHE_SIZE = 2048;
+
+    // bumped on every invalidation so a read racing a write is not cached
+    QMutex m_cache_mutex;
+    QCache<qint64, NodeInfo> m_node_cache{NODE_CACHE_SIZE};
+    quint64 m_cache_generation = 0;
+
+    QMutex m_latency_mutex;
+    QHash<qint64, qint64> m_pending_latency;
+    QList<LatencySample> m_pending_samples;
+    QTimer m_latency_timer;
+
+    // maintenance waits for this many rows written since the last run and
+    // for the writer to be quiet, each step frees or merges a few pages
+    static constexpr int MAINTENANCE_INTERVAL = 10 * 1000;
+    static constexpr qint64 MAINTENANCE_IDLE_TIME = 30 * 1000;
+    static constexpr qint64 MAINTENANCE_CHURN = 1000;
+    static constexpr int MAINTENANCE_MERGE_PAGES = 64;
+    static constexpr int MAINTENANCE_VACUUM_PAGES = 256;
+    static constexpr int MAINTENANCE_ANALYSIS_LIMIT = 400;
+
+    std::atomic<qint64> m_last_write = 0;
+    QTimer m_maintenance_timer;
+    MaintenanceStep m_maintenance_step = MaintenanceStep::done;
+    MaintenanceReport m_maintenance;
+    QElapsedTimer m_maintenance_clock;
+    qint64 m_changes_baseline = 0;
+    qint64 m_size_before = 0;
+    quint64 m_maintenance_serial = 0;
+    bool m_is_maintaining = false;
 
+    QThread *p_db_thread = nullptr;
     DBWorker *p_worker = nullptr;
-    QSqlError tmp_direct_res;
-    QPair<QSqlError, qint64> tmp_step_res;
+    bool m_is_open = false;
+
+    // declared before the pool so connections outlive the pool threads
+    QThreadStorage<DBConnection *> m_read_connections;
+    std::atomic<int> m_read_serial = 0;
+    QThreadPool m_read_pool;
+
+    // node rows go through p_nodes, chosen with the backend
+    SQLiteNodeStorage m_sqlite_nodes;
+    MemoryNodeStorage m_memory_nodes;
+    NodeStorage *p_nodes = &m_sqlite_nodes;
 
     std::shared_ptr<spdlog::logger> p_logger;
     QString m_db_path = "across.db";
+    DBBackend m_backend = DBBackend::sqlite3;
 };
 
-class TransactionWrap {
-  public:
-    inline explicit TransactionWrap(DBTools *db_tools) : p_db(db_tools) {
-        mutex.lock();
-        p_db->directExec("BEGIN");
-    }
-
-    inline ~TransactionWrap() {
-        p_db->directExec("END;");
-        mutex.unlock();
-    }
-
-  private:
-    QPointer<DBTools> p_db;
-    QMutex mutex;
-};
+template <typename Func>
+auto DBTools::submit(Func &&func)
+    -> QFuture<std::invoke_result_t<Func, DBConnection *>> {
+    m_last_write = QDateTime::currentMSecsSinceEpoch();
+
+    return post(std::forward<Func>(func));
+}
+
+template <typename Func>
+auto DBTools::post(Func &&func)
+    -> QFuture<std::invoke_result_t<Func, DBConnection *>> {
+    using Result = std::invoke_result_t<Func, DBConnection *>;
+
+    auto promise = std::make_shared<QPromise<Result>>();
+    auto future = promise->future();
+    promise->start();
+
+    p_worker->enqueue([promise, func = std::forward<Func>(func)](
+                          DBConnection *connection) mutable {
+        if constexpr (std::is_void_v<Result>) {
+            func(connection);
+        } else {
+            promise->addResult(func(connection));
+        }
+        promise->finish();
+    });
+
+    return future;
+}
+
+template <typename Func>
+auto DBTools::read(Func &&func)
+    -> QFuture<std::invoke_result_t<Func, DBConnection *>> {
+    // an in-memory database is only visible to the connection owning it
+    if (m_backend != DBBackend::sqlite3)
+        return post(std::forward<Func>(func));
+
+    return QtConcurrent::run(
+        &m_read_pool, [this, db_path = m_db_path,
+                       func = std::forward<Func>(func)]() mutable {
+            return func(readConnection(db_path));
+        });
+}
 } // namespace across
 
 #endif // DBTOOLS_H
@@ -220,12 +220,20 @@ CURLcode CURLTools::download(const DownloadTask &task) {
         }
 
         // data callback
-        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &dataCallback);
-        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &buffer);
+        if (temp_task.sink != nullptr) {
+            curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &sinkCallback);
+            curl_easy_setopt(handle, CURLOPT_WRITEDATA, temp_task.sink.get());
+        } else {
+            curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &dataCallback);
+            curl_easy_setopt(handle, CURLOPT_WRITEDATA, &buffer);
+        }
 
         // execute
         if (auto err = curl_easy_perform(handle); err == CURLE_OK) {
-            temp_task.content = QString::fromStdString(buffer.str());
+            if (temp_task.sink != nullptr)
+                temp_task.sink->finish();
+            else
+                temp_task.content = QString::fromStdString(buffer.str());
         }
 
         // clean handle
@@ -248,6 +256,82 @@ size_t CURLTools::dataCallback(void *contents, size_t size, size_t nmemb,
     return real_size;
 }
 
+size_t CURLTools::sinkCallback(void *contents, size_t size, size_t nmemb,
+                               void *p_sink) {
+    size_t real_size = size * nmemb;
+    auto sink = reinterpret_cast<DownloadSink *>(p_sink);
+    sink->write(reinterpret_cast<const char *>(contents), real_size);
+    return real_size;
+}
+
+LineDecoder::LineDecoder(LineHandler handler) : m_handler(std::move(handler)) {}
+
+void LineDecoder::feed(const char *data, size_t size) {
+    if (m_mode == Mode::unknown) {
+        m_pending.append(data, size);
+
+        if (m_pending.find(':') != std::string::npos) {
+            m_mode = Mode::plain;
+        } else if (m_pending.find('\n') != std::string::npos ||
+                   m_pending.size() >= MODE_PROBE_SIZE) {
+            m_mode = Mode::base64;
+        } else {
+            return;
+        }
+
+        std::string pending;
+        pending.swap(m_pending);
+        feed(pending.data(), pending.size());
+        return;
+    }
+
+    if (m_mode == Mode::plain)
+        feedPlain(data, size);
+    else
+        feedBase64(data, size);
+}
+
+void LineDecoder::finish() {
+    // a short body never reached the probe size
+    if (m_mode == Mode::unknown && !m_pending.empty()) {
+        m_mode = Mode::base64;
+
+        std::string pending;
+        pending.swap(m_pending);
+        feed(pending.data(), pending.size());
+    }
+
+    // padding is optional
+    char rest[2];
+    feedPlain(rest, m_base64.finish(rest));
+
+    if (!m_line.empty()) {
+        m_handler(m_line);
+        m_line.clear();
+    }
+}
+
+void LineDecoder::feedPlain(const char *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        switch (auto c = data[i]; c) {
+        case '\r':
+            break;
+        case '\n':
+            m_handler(m_line);
+            m_line.clear();
+            break;
+        default:
+            m_line.push_back(c);
+            break;
+        }
+    }
+}
+
+void LineDecoder::feedBase64(const char *data, size_t size) {
+    m_decoded.resize(Base64Decoder::maxDecodedSize(size));
+    feedPlain(m_decoded.data(), m_base64.decode(data, size, m_decoded.data()));
+}
+
 QString UpdateTools::getVersion(const QString &content) {
     Json::string_t err_msg;
     Json root;
@@ -1,6 +1,7 @@
 #ifndef NETWORKTOOLS_H
 #define NETWORKTOOLS_H
 
+#include "base64tools.h"
 #include "curl/curl.h"
 #include "nlohmann/json.hpp"
 #include "semver.hpp"
@@ -17,7 +18,10 @@
 #include <QTime>
 #include <QtConcurrent>
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -73,6 +77,48 @@ class TCPPing : QObject {
     static const int PING_TIMEOUT = 3000;
 };
 
+// receives the body of a download while it arrives, finish is only called
+// once the transfer succeeded
+class DownloadSink {
+  public:
+    virtual ~DownloadSink() = default;
+
+    virtual void write(const char *data, size_t size) = 0;
+    virtual void finish() = 0;
+};
+
+// splits a subscription body into lines as it arrives, a base64 body is
+// decoded on the fly and plain share links are passed through
+class LineDecoder {
+  public:
+    using LineHandler = std::function<void(const std::string &line)>;
+
+    explicit LineDecoder(LineHandler handler);
+
+    void feed(const char *data, size_t size);
+    void finish();
+
+  private:
+    enum class Mode : int {
+        unknown,
+        plain,
+        base64,
+    };
+
+    void feedPlain(const char *data, size_t size);
+    void feedBase64(const char *data, size_t size);
+
+    // base64 never contains ':', share links do in their first line
+    static constexpr size_t MODE_PROBE_SIZE = 64;
+
+    LineHandler m_handler;
+    Mode m_mode = Mode::unknown;
+    std::string m_pending;
+    std::string m_line;
+    std::string m_decoded;
+    Base64Decoder m_base64;
+};
+
 struct DownloadTask {
     qint64 id;
     QString name;
@@ -81,6 +127,8 @@ struct DownloadTask {
     QString proxy;
     QString content;
     bool is_updated = false;
+    // when set the body is streamed into it and content stays empty
+    std::shared_ptr<DownloadSink> sink = nullptr;
 };
 
 class CURLTools : public QObject {
@@ -105,6 +153,8 @@ class CURLTools : public QObject {
 
     static size_t dataCallback(void *contents, size_t size, size_t nmemb,
                                void *p_data);
+    static size_t sinkCallback(void *contents, size_t size, size_t nmemb,
+                               void *p_sink);
 };
 
 class UpdateTools {
@@ -1,7 +1,155 @@
 #include "serializetools.h"
 
+#include <cctype>
+#include <charconv>
+
 using namespace across;
 
+namespace {
+int hexValue(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+std::string_view trimmed(std::string_view value) {
+    constexpr std::string_view spaces = " \t\r\n";
+
+    auto begin = value.find_first_not_of(spaces);
+    if (begin == std::string_view::npos)
+        return {};
+
+    auto end = value.find_last_not_of(spaces);
+    return value.substr(begin, end - begin + 1);
+}
+} // namespace
+
+std::optional<ShareLink> ShareLink::parse(std::string_view url) {
+    // scheme:[//[user_info@]host[:port]]path[?query][#fragment]
+    auto is_scheme_char = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '+' ||
+               c == '-' || c == '.';
+    };
+
+    auto colon = url.find(':');
+    if (colon == 0 || colon == std::string_view::npos ||
+        !std::isalpha(static_cast<unsigned char>(url.front())))
+        return {};
+
+    ShareLink link;
+    link.scheme = url.substr(0, colon);
+    for (auto c : link.scheme) {
+        if (!is_scheme_char(c))
+            return {};
+    }
+
+    auto rest = url.substr(colon + 1);
+
+    if (auto hash = rest.find('#'); hash != std::string_view::npos) {
+        link.fragment = rest.substr(hash + 1);
+        rest = rest.substr(0, hash);
+    }
+
+    if (auto question = rest.find('?'); question != std::string_view::npos) {
+        link.query = rest.substr(question + 1);
+        rest = rest.substr(0, question);
+    }
+
+    if (!rest.starts_with("//")) {
+        link.path = rest;
+        return link;
+    }
+
+    rest.remove_prefix(2);
+    auto slash = rest.find('/');
+    auto authority = rest.substr(0, slash);
+    if (slash != std::string_view::npos)
+        link.path = rest.substr(slash);
+
+    if (auto at = authority.rfind('@'); at != std::string_view::npos) {
+        link.user_info = authority.substr(0, at);
+        authority = authority.substr(at + 1);
+    }
+
+    if (authority.starts_with('[')) {
+        auto bracket = authority.find(']');
+        if (bracket == std::string_view::npos)
+            return {};
+
+        link.host = authority.substr(1, bracket - 1);
+        authority = authority.substr(bracket + 1);
+        if (!authority.empty() && !authority.starts_with(':'))
+            return {};
+        if (!authority.empty())
+            link.port = authority.substr(1);
+    } else if (auto port_colon = authority.rfind(':');
+               port_colon != std::string_view::npos) {
+        link.host = authority.substr(0, port_colon);
+        link.port = authority.substr(port_colon + 1);
+    } else {
+        link.host = authority;
+    }
+
+    return link;
+}
+
+std::string ShareLink::decode(std::string_view component) {
+    std::string result;
+    result.reserve(component.size());
+
+    for (size_t i = 0; i < component.size(); ++i) {
+        if (component[i] == '%' && i + 2 < component.size()) {
+            auto high = hexValue(component[i + 1]);
+            auto low = hexValue(component[i + 2]);
+            if (high >= 0 && low >= 0) {
+                result.push_back(static_cast<char>(high << 4 | low));
+                i += 2;
+                continue;
+            }
+        }
+        result.push_back(component[i]);
+    }
+
+    return result;
+}
+
+std::optional<uint32_t> ShareLink::portNumber() const {
+    if (port.empty())
+        return {};
+
+    uint32_t value = 0;
+    auto end = port.data() + port.size();
+    auto [ptr, ec] = std::from_chars(port.data(), end, value);
+    if (ec != std::errc() || ptr != end || value > 65535)
+        return {};
+
+    return value;
+}
+
+std::optional<std::string_view>
+ShareLink::queryItem(std::string_view key) const {
+    auto items = query;
+    while (!items.empty()) {
+        auto amp = items.find('&');
+        auto item = items.substr(0, amp);
+        items = amp == std::string_view::npos ? std::string_view()
+                                              : items.substr(amp + 1);
+
+        auto equal = item.find('=');
+        if (item.substr(0, equal) != key)
+            continue;
+
+        return equal == std::string_view::npos ? std::string_view()
+                                               : item.substr(equal + 1);
+    }
+
+    return {};
+}
+
 std::optional<std::vector<URLMetaObject>>
 SerializeTools::sip008Parser(const std::string &url_str) {
     Json root;
@@ -54,10 +202,21 @@ SerializeTools::sip002Decode(const std::string &url_str) {
     // url scheme:
     // ss://<websafe-base64-encode-utf8(method:password)>@hostname:port/?plugin"#"tag
 
-    QUrl url(url_str.c_str());
+    auto link = ShareLink::parse(url_str);
+    if (!link.has_value() || link->host.empty())
+        return {};
+
+    auto port = link->portNumber();
+    if (!port.has_value())
+        return {};
+
+    auto user_info = Base64Tools::decode(ShareLink::decode(link->user_info));
+    auto separator = user_info.find(':');
+    if (separator == std::string::npos)
+        return {};
 
     URLMetaObject meta;
-    meta.name = url.fragment(QUrl::FullyDecoded).toStdString();
+    meta.name = ShareLink::decode(link->fragment);
 
     auto outbound = &meta.outbound;
     outbound->set_protocol("shadowsocks");
@@ -66,14 +225,10 @@ SerializeTools::sip002Decode(const std::string &url_str) {
     auto shadowsocks = outbound->mutable_settings()->mutable_shadowsocks();
     auto server = shadowsocks->add_servers();
 
-    QString user_info = QByteArray::fromBase64(url.userInfo().toUtf8());
-    if (user_info.isEmpty())
-        return {};
-
-    server->set_address(url.host().toStdString());
-    server->set_port(url.port());
-    server->set_password(user_info.split(":").last().toStdString());
-    server->set_method(user_info.split(":").first().toStdString());
+    server->set_address(std::string(link->host));
+    server->set_port(port.value());
+    server->set_method(user_info.substr(0, separator));
+    server->set_password(user_info.substr(separator + 1));
 
     return meta;
 }
@@ -87,16 +242,14 @@ std::optional<QUrl> SerializeTools::sip002Encode(const URLMetaObject &meta) {
     auto setting = outbound->settings().shadowsocks();
     const auto& server = setting.servers(0);
 
-    QString user_info =
-        QString("%1:%2")
-            .arg(server.method().c_str(), server.password().c_str())
-            .toUtf8()
-            .toBase64(QByteArray::Base64UrlEncoding);
+    auto user_info = Base64Tools::encode(
+        server.method() + ":" + server.password(),
+        Base64Tools::Alphabet::url_safe);
 
     url.setScheme("ss");
     url.setHost(server.address().c_str());
     url.setPort(server.port());
-    url.setUserInfo(user_info);
+    url.setUserInfo(QString::fromStdString(user_info));
     url.setFragment(meta.name.c_str());
 
     return url;
@@ -107,10 +260,20 @@ SerializeTools::trojanDecode(const std::string &url_str) {
     // url scheme:
     // trojan://<password>@<host>:<port>?sni=<server_name>&allowinsecure=<allow_insecure>&alpn=h2%0Ahttp/1.1#<name>
 
-    QUrl url(url_str.c_str());
+    auto link = ShareLink::parse(url_str);
+    if (!link.has_value() || link->host.empty() || link->user_info.empty() ||
+        link->scheme.find("trojan") == std::string_view::npos)
+        return {};
+
+    // port defaults to 443 when omitted
+    std::optional<uint32_t> port = 443;
+    if (!link->port.empty())
+        port = link->portNumber();
+    if (!port.has_value())
+        return {};
 
     URLMetaObject meta;
-    meta.name = url.fragment(QUrl::FullyDecoded).toStdString();
+    meta.name = ShareLink::decode(link->fragment);
 
     auto outbound = &meta.outbound;
     outbound->set_protocol("trojan");
@@ -119,52 +282,44 @@ SerializeTools::trojanDecode(const std::string &url_str) {
     auto trojan = outbound->mutable_settings()->mutable_trojan();
     auto server = trojan->add_servers();
 
-    if (url.host().isEmpty() || url.userInfo().isEmpty() ||
-        !url.scheme().contains("trojan"))
-        return {};
-
-    server->set_address(url.host().toStdString());
-    server->set_port(url.port());
-    server->set_password(url.userInfo().toStdString());
+    server->set_address(std::string(link->host));
+    server->set_port(port.value());
+    server->set_password(ShareLink::decode(link->user_info));
 
     // query need to be verified
-    if (url.hasQuery()) {
-        QUrlQuery url_query(url);
-
+    if (!link->query.empty()) {
         auto stream = outbound->mutable_streamsettings();
         auto tls = stream->mutable_tlssettings();
 
-        if (url_query.hasQueryItem("sni")) {
-            tls->set_servername(url_query.queryItemValue("sni").toStdString());
+        if (auto sni = link->queryItem("sni"); sni.has_value()) {
+            tls->set_servername(ShareLink::decode(sni.value()));
         }
 
-        if (url_query.hasQueryItem("allowinsecure")) {
-            if (url_query.queryItemValue("allowinsecure")
-                    .toLower()
-                    .contains("true"))
+        if (auto insecure = link->queryItem("allowinsecure");
+            insecure.has_value()) {
+            auto value = ShareLink::decode(insecure.value());
+            for (auto &c : value)
+                c = static_cast<char>(std::tolower(static_cast<uint8_t>(c)));
+
+            if (value.find("true") != std::string::npos)
                 tls->set_allowinsecure(true);
         } else {
             stream->set_network("tcp");
             stream->set_security("tls");
         }
 
-        if (url_query.hasQueryItem("alpn")) {
-            auto alpn = url_query.queryItemValue("alpn", QUrl::FullyDecoded);
-
-            QStringList values;
-
-            if (alpn.contains(",")) {
-                values = alpn.split(",");
-            } else if (alpn.contains("\n")) {
-                values = alpn.split("\n");
-            }
-
-            if (values.empty()) {
-                tls->add_alpn(alpn.toStdString());
-            } else {
-                for (auto &item : values) {
-                    tls->add_alpn(item.toStdString());
-                }
+        if (auto alpn = link->queryItem("alpn"); alpn.has_value()) {
+            auto values = ShareLink::decode(alpn.value());
+            auto separator =
+                values.find(',') != std::string::npos ? ',' : '\n';
+
+            std::string_view rest = values;
+            while (true) {
+                auto end = rest.find(separator);
+                tls->add_alpn(std::string(rest.substr(0, end)));
+                if (end == std::string_view::npos)
+                    break;
+                rest.remove_prefix(end + 1);
             }
         } else {
             tls->add_alpn("http/1.1");
@@ -244,15 +399,15 @@ SerializeTools::vmessBase64Decode(const std::string &url_str) {
     //     "sni": "www.ccc.com"
     //  }
 
-    QString info = QString::fromStdString(url_str).split("://").takeLast();
-    if (info.isEmpty())
+    std::string_view info = url_str;
+    if (auto separator = info.rfind("://"); separator != std::string::npos)
+        info.remove_prefix(separator + 3);
+    if (info.empty())
         return {};
 
-    QString base64_str = QByteArray::fromBase64(info.toUtf8());
-
     Json root;
     try {
-        root = Json::parse(base64_str.toStdString());
+        root = Json::parse(Base64Tools::decode(info));
     } catch (Json::exception &e) {
         qDebug() << e.what();
         return {};
@@ -330,13 +485,18 @@ SerializeTools::vmessBase64Decode(const std::string &url_str) {
                 auto http2 = stream->mutable_httpsettings();
 
                 if (root.contains("host")) {
-                    auto content =
-                        QString::fromStdString(root["host"].get<std::string>())
-                            .trimmed()
-                            .split(",");
-                    for (const auto &host : content) {
-                        if (!host.isEmpty())
-                            http2->add_host(host.trimmed().toStdString());
+                    const auto &content =
+                        root["host"].get_ref<const Json::string_t &>();
+
+                    std::string_view rest = content;
+                    while (!rest.empty()) {
+                        auto comma = rest.find(',');
+                        auto host = trimmed(rest.substr(0, comma));
+                        if (!host.empty())
+                            http2->add_host(std::string(host));
+                        if (comma == std::string_view::npos)
+                            break;
+                        rest.remove_prefix(comma + 1);
                     }
                 }
 
@@ -500,26 +660,26 @@ SerializeTools::vmessBase64Encode(const URLMetaObject &meta) {
     // TODO: support fake stream type
     root["type"] = "none";
 
-    url.setUserInfo(QString::fromStdString(root.dump()).toUtf8().toBase64());
+    url.setUserInfo(QString::fromStdString(Base64Tools::encode(root.dump())));
 
     return url;
 }
 
 bool SerializeTools::decodeOutboundFromURL(NodeInfo &node,
                                            const std::string &url_str) {
-    node.url = url_str.c_str();
+    node.url = QString::fromStdString(url_str);
 
-    QUrl url(url_str.c_str());
-    if (url.scheme().isEmpty())
+    auto link = ShareLink::parse(url_str);
+    if (!link.has_value())
         return false;
 
-    if (url.scheme().contains("vmess"))
+    if (link->scheme.find("vmess") != std::string_view::npos)
         return SerializeTools::setVMessOutboundFromBase64(node, url_str);
 
-    if (url.scheme().contains("trojan"))
+    if (link->scheme.find("trojan") != std::string_view::npos)
         return SerializeTools::setTrojanOutboundFromURL(node, url_str);
 
-    if (url.scheme() == "ss") {
+    if (link->scheme == "ss") {
         return SerializeTools::setShadowsocksOutboundFromURL(node, url_str);
     }
 
@@ -532,16 +692,17 @@ bool SerializeTools::setShadowsocksOutboundFromURL(NodeInfo &node,
     if (!meta.has_value())
         return false;
 
-    auto outbound = meta->outbound;
-    auto shadowsocks = outbound.settings().shadowsocks();
+    const auto &outbound = meta->outbound;
+    const auto &shadowsocks = outbound.settings().shadowsocks();
     const auto& server = shadowsocks.servers(0);
 
     node.protocol = EntryType::shadowsocks;
-    node.name = meta->name.c_str();
+    node.name = QString::fromStdString(meta->name);
     node.address = server.address().c_str();
     node.port = server.port();
     node.password = server.password().c_str();
     node.raw = MessageToJson(outbound).c_str();
+    node.outbound = MessageToBytes(outbound);
 
     return true;
 }
@@ -552,17 +713,18 @@ bool SerializeTools::setVMessOutboundFromBase64(NodeInfo &node,
     if (!meta.has_value())
         return false;
 
-    auto outbound = meta->outbound;
-    auto vmess = outbound.settings().vmess();
+    const auto &outbound = meta->outbound;
+    const auto &vmess = outbound.settings().vmess();
     const auto& server = vmess.vnext(0);
     const auto& user = server.users(0);
 
     node.protocol = EntryType::vmess;
-    node.name = meta->name.c_str();
+    node.name = QString::fromStdString(meta->name);
     node.address = server.address().c_str();
     node.port = server.port();
     node.password = user.id().c_str();
     node.raw = MessageToJson(outbound).c_str();
+    node.outbound = MessageToBytes(outbound);
 
     return true;
 }
@@ -573,16 +735,17 @@ bool SerializeTools::setTrojanOutboundFromURL(NodeInfo &node,
     if (!meta.has_value())
         return false;
 
-    auto outbound = meta->outbound;
-    auto trojan = outbound.settings().trojan();
+    const auto &outbound = meta->outbound;
+    const auto &trojan = outbound.settings().trojan();
     const auto& server = trojan.servers(0);
 
     node.protocol = EntryType::trojan;
-    node.name = meta->name.c_str();
+    node.name = QString::fromStdString(meta->name);
     node.address = server.address().c_str();
     node.port = server.port();
     node.password = server.password().c_str();
     node.raw = MessageToJson(outbound).c_str();
+    node.outbound = MessageToBytes(outbound);
 
     return true;
 }
@@ -626,6 +789,18 @@ SerializeTools::JsonToOutbound(const std::string &json_str) {
     return outbound;
 }
 
+QByteArray
+SerializeTools::MessageToBytes(const google::protobuf::Message &message) {
+    return QByteArray::fromStdString(message.SerializeAsString());
+}
+
+v2ray::config::OutboundObject
+SerializeTools::BytesToOutbound(const QByteArray &bytes) {
+    v2ray::config::OutboundObject outbound;
+    outbound.ParseFromArray(bytes.constData(), static_cast<int>(bytes.size()));
+    return outbound;
+}
+
 std::string
 SerializeTools::ConfigToJson(v2ray::config::V2RayConfig &origin_config,
                              const QString &outbound_str) {
@@ -1,6 +1,7 @@
 #ifndef SERIALIZETOOLS_H
 #define SERIALIZETOOLS_H
 
+#include "base64tools.h"
 #include "dbtools.h"
 
 #include "google/protobuf/util/json_util.h"
@@ -10,8 +11,10 @@
 #include <QString>
 #include <QUrl>
 #include <QUrlQuery>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include "across.grpc.pb.h"
 #include "v2ray_config.grpc.pb.h"
@@ -24,6 +27,23 @@ struct URLMetaObject {
     v2ray::config::OutboundObject outbound;
 };
 
+// views into a share link, components are left percent-encoded
+struct ShareLink {
+    std::string_view scheme;
+    std::string_view user_info;
+    std::string_view host;
+    std::string_view port;
+    std::string_view path;
+    std::string_view query;
+    std::string_view fragment;
+
+    static std::optional<ShareLink> parse(std::string_view url);
+    static std::string decode(std::string_view component);
+
+    std::optional<uint32_t> portNumber() const;
+    std::optional<std::string_view> queryItem(std::string_view key) const;
+};
+
 class SerializeTools {
   public:
     // Shadowsocks
@@ -62,6 +82,9 @@ class SerializeTools {
     JsonToACrossConfig(const std::string &json_str);
     static v2ray::config::OutboundObject
     JsonToOutbound(const std::string &json_str);
+    static QByteArray MessageToBytes(const google::protobuf::Message &message);
+    static v2ray::config::OutboundObject
+    BytesToOutbound(const QByteArray &bytes);
     static std::string ConfigToJson(v2ray::config::V2RayConfig &origin_config,
                                     const QString &outbounds_str = "");
 };
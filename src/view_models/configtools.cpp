@@ -869,6 +869,8 @@ int ConfigTools::logLines() { return m_config.log_lines(); }
 
 QString ConfigTools::dbPath() { return p_db->db_path().c_str(); }
 
+QString ConfigTools::dbBackend() { return p_db->db_backend().c_str(); }
+
 bool ConfigTools::apiEnable() { return p_core->api().enable(); }
 
 QString ConfigTools::apiPort() {
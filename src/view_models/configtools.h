@@ -206,6 +206,7 @@ class ConfigTools : public QObject {
     // database setting
     QString dataDir();
     QString dbPath();
+    QString dbBackend();
 
     // core setting
     QString coreInfo();
@@ -42,24 +42,189 @@ void GroupList::init(QSharedPointer<across::setting::ConfigTools> config,
     connect(this, &GroupList::nodeLatencyChanged, this,
             &GroupList::handleNodeLatencyChanged);
 
-    reloadItems();
-    checkAllUpdate();
+    loadGroups([this] { checkAllUpdate(); });
 }
 
-bool GroupList::insert(const GroupInfo &group_info, const QString &content) {
-    bool result = false;
+void GroupList::insert(const GroupInfo &group_info, const QString &content,
+                       std::function<void(bool)> after) {
+    if (p_db == nullptr) {
+        after(false);
+        return;
+    }
+
+    insertItems(parseAsync(group_info, content), after);
+}
+
+void GroupList::insertItems(QFuture<std::optional<QList<NodeInfo>>> parsing,
+                            const std::function<void(bool)> &after) {
+    parsing.then(this, [this, after](std::optional<QList<NodeInfo>> nodes) {
+        if (!nodes.has_value()) {
+            after(false);
+            return;
+        }
+
+        p_db->bulkInsert(nodes.value())
+            .then(this, [this, after](const QSqlError &result) {
+                if (result.type() != QSqlError::NoError) {
+                    after(false);
+                    return;
+                }
+
+                reloadItems();
+                after(true);
+            });
+    });
+}
+
+SubscriptionStream::SubscriptionStream()
+    : m_decoder([this](const std::string &line) {
+          if (m_is_ended || line.empty()) {
+              m_is_ended = true;
+              return;
+          }
+
+          m_lines.append(QString::fromStdString(line));
+          if (m_lines.size() == CHUNK_SIZE)
+              dispatch();
+      }) {}
+
+void SubscriptionStream::write(const char *data, size_t size) {
+    m_decoder.feed(data, size);
+}
+
+void SubscriptionStream::finish() {
+    m_decoder.finish();
+    dispatch();
+
+    m_is_finished = true;
+}
+
+bool SubscriptionStream::isFinished() const { return m_is_finished; }
+
+std::optional<QList<NodeInfo>>
+SubscriptionStream::result(const GroupInfo &group_info) {
+    if (!m_is_finished)
+        return {};
+
+    QList<NodeInfo> nodes;
+    for (auto &chunk : m_chunks) {
+        auto decoded = chunk.result();
+        if (!decoded.has_value())
+            return {};
+
+        for (auto &node : decoded.value()) {
+            node.group_id = group_info.id;
+            node.group_name = group_info.name;
+            nodes.append(node);
+        }
+    }
+
+    return nodes;
+}
+
+std::optional<QList<NodeInfo>>
+SubscriptionStream::decode(const GroupInfo &group_info,
+                           const QStringList &lines) {
+    QList<NodeInfo> nodes;
+    nodes.reserve(lines.size());
+
+    for (auto &line : lines) {
+        NodeInfo node = {
+            .group_id = group_info.id,
+            .group_name = group_info.name,
+            .routing_id = 0,
+            .routing_name = "default_routings",
+        };
+
+        if (!SerializeTools::decodeOutboundFromURL(node, line.toStdString()))
+            return {};
+
+        nodes.append(node);
+    }
+
+    return nodes;
+}
+
+void SubscriptionStream::dispatch() {
+    if (m_lines.isEmpty())
+        return;
+
+    QStringList lines;
+    lines.swap(m_lines);
+    m_chunks.append(QtConcurrent::run(
+        [lines] { return decode(GroupInfo(), lines); }));
+}
+
+std::optional<QList<NodeInfo>> GroupList::parse(const GroupInfo &group_info,
+                                                const QString &content) {
     switch (group_info.type) {
     case base64:
-        result = this->insertBase64(group_info, content);
-        break;
+        return parseBase64(group_info, content);
     case sip008:
-        result = this->insertSIP008(group_info, content);
-        break;
+        return parseSIP008(group_info, content);
 
     default:
         break;
     }
-    return result;
+    return {};
+}
+
+QFuture<std::optional<QList<NodeInfo>>>
+GroupList::parseAsync(const GroupInfo &group_info, const QString &content) {
+    return QtConcurrent::run(
+        [this, group_info, content] { return parse(group_info, content); });
+}
+
+QFuture<std::optional<QList<NodeInfo>>>
+GroupList::parseDownloaded(const GroupInfo &group_info,
+                           const DownloadTask &task) {
+    // streamed bodies were parsed while they arrived
+    if (auto stream = std::dynamic_pointer_cast<SubscriptionStream>(task.sink);
+        stream != nullptr) {
+        return QtConcurrent::run(
+            [stream, group_info] { return stream->result(group_info); });
+    }
+
+    return parseAsync(group_info, task.content);
+}
+
+void GroupList::download(DownloadTask task, SubscriptionType type) {
+    if (type == base64)
+        task.sink = std::make_shared<SubscriptionStream>();
+
+    p_nodes->setDownloadProxy(task);
+
+    p_curl->download(task);
+}
+
+void GroupList::sync(const GroupInfo &group_info, const QString &content) {
+    if (p_db == nullptr)
+        return;
+
+    parseAsync(group_info, content)
+        .then(this, [this, group_info](std::optional<QList<NodeInfo>> nodes) {
+            if (!nodes.has_value()) {
+                p_logger->error("Failed to parse subscription: {}",
+                                group_info.name.toStdString());
+                return;
+            }
+
+            using SyncResult = QPair<QSqlError, GroupSyncDelta>;
+            p_db->syncGroup(group_info.id, nodes.value())
+                .then(this, [this, group_info](const SyncResult &result) {
+                    auto &[error, delta] = result;
+                    if (error.type() != QSqlError::NoError)
+                        return;
+
+                    p_logger->info("Synced group {}: {} added, {} updated, "
+                                   "{} removed, {} unchanged",
+                                   group_info.name.toStdString(),
+                                   delta.inserted, delta.updated,
+                                   delta.removed, delta.unchanged);
+
+                    reloadItems();
+                });
+        });
 }
 
 QList<GroupInfo> GroupList::items() const { return m_groups; }
@@ -97,9 +262,7 @@ void GroupList::checkUpdate(int index, bool force) {
             .is_updated = true,
         };
 
-        p_nodes->setDownloadProxy(task);
-
-        p_curl->download(task);
+        download(task, group.type);
     } while (false);
 }
 
@@ -113,24 +276,25 @@ Q_INVOKABLE int GroupList::testTcpPing(int index) {
         }
         m_is_tcpPinging[group.id] = true;
 
-        auto nodes = p_db->listAllNodesFromGroupID(group.id);
-
-        m_tcpPinging_count[group.id] = 0;
-        m_group_size[group.id] = nodes.size();
-        m_tcpPinging_notifications[group.id] = p_notifications->append(
-            tr("[%1] TCP Pinging...").arg(group.name),
-            tr("Testing: %1/%2").arg("0").arg(QString::number(m_group_size[group.id])),
-            0.0,
-            m_group_size[group.id],
-            0.0
-        );
-
-        for (int i = 0; i < nodes.size(); ++i) {
-            auto &node = nodes[i];
-            p_nodes->testLatency(node, i, [this, node, i] {
-                emit nodeLatencyChanged(node.group_id, i, node);
+        p_db->listNodeSummariesFromGroupIDAsync(group.id).then(
+            this, [this, group](QList<NodeSummary> nodes) {
+                m_tcpPinging_count[group.id] = 0;
+                m_group_size[group.id] = nodes.size();
+                m_tcpPinging_notifications[group.id] = p_notifications->append(
+                    tr("[%1] TCP Pinging...").arg(group.name),
+                    tr("Testing: %1/%2").arg("0").arg(QString::number(m_group_size[group.id])),
+                    0.0,
+                    m_group_size[group.id],
+                    0.0
+                );
+
+                for (int i = 0; i < nodes.size(); ++i) {
+                    auto &node = nodes[i];
+                    p_nodes->testLatency(node, i, [this, node, i] {
+                        emit nodeLatencyChanged(node.group_id, i, node);
+                    });
+                }
             });
-        }
     }
     return 0;
 }
@@ -142,7 +306,7 @@ Q_INVOKABLE int GroupList::testTcpPingLeft(int index) {
     return 0;
 }
 void GroupList::handleNodeLatencyChanged(qint64 group_id, int index,
-                                         const across::NodeInfo &node) {
+                                         const across::NodeSummary &node) {
     m_tcpPinging_count[group_id]++;
     m_tcpPinging_notifications[group_id]->setMessage(tr("Testing: %1/%2")
                                                     .arg(QString::number(m_tcpPinging_count[group_id]))
@@ -167,10 +331,19 @@ Q_INVOKABLE int GroupList::getIndexByID(int id) {
 }
 
 void GroupList::search(const QString &value) {
-    QList<GroupInfo> temp_groups;
-    auto iter = m_origin_groups.begin();
-    auto results = p_db->search(value);
+    auto serial = ++m_search_serial;
+
+    p_db->search(value).then(
+        this, [this, serial](const QList<SearchResult> &results) {
+            // a later keystroke superseded this search
+            if (serial != m_search_serial)
+                return;
 
+            showSearchResults(results);
+        });
+}
+
+void GroupList::showSearchResults(const QList<SearchResult> &results) {
     if (results.isEmpty()) {
         emit preItemsReset();
         m_groups.clear();
@@ -179,15 +352,16 @@ void GroupList::search(const QString &value) {
         return;
     }
 
-    for (auto &result : results.toStdMap()) {
-        for (; iter != m_origin_groups.end(); ++iter) {
-            if (iter->id == result.first) {
-                auto group = *iter;
-                group.items = result.second.size();
-                temp_groups.append(group);
-                ++iter;
-                break;
-            }
+    QMap<qint64, QList<qint64>> nodes_id;
+    for (auto &result : results)
+        nodes_id[result.group_id].append(result.node_id);
+
+    QList<GroupInfo> temp_groups;
+    for (auto &group : m_origin_groups) {
+        if (auto iter = nodes_id.constFind(group.id);
+            iter != nodes_id.cend()) {
+            temp_groups.append(group);
+            temp_groups.last().items = iter->size();
         }
     }
 
@@ -195,12 +369,13 @@ void GroupList::search(const QString &value) {
     m_groups = temp_groups;
     emit postItemsReset();
 
-    p_nodes->setFilter(results);
-    p_nodes->reloadItems();
-    setDisplayGroupID(results.firstKey());
+    // open the group holding the best match
+    p_nodes->setFilter(nodes_id, results.first().group_id);
 }
 
 void GroupList::clearSearch() {
+    ++m_search_serial;
+
     emit preItemsReset();
     m_groups = m_origin_groups;
     emit postItemsReset();
@@ -238,32 +413,38 @@ void GroupList::reloadItems(bool reopen_db) {
         p_db->reload();
     }
 
-    if (auto result = p_db->reloadAllGroupsInfo();
-        result.type() == QSqlError::NoError) {
-        emit preItemsReset();
-        m_groups = p_db->getAllGroupsInfo();
-        emit postItemsReset();
+    loadGroups();
+}
 
-        if (m_groups.isEmpty()) {
-            p_logger->warn("No group items from database");
-            return;
-        } else {
-            m_origin_groups = m_groups;
-        }
-    }
+void GroupList::loadGroups(const std::function<void()> &after) {
+    p_db->reloadAllGroupsInfo().then(
+        this, [this, after](const QSqlError &result) {
+            if (result.type() == QSqlError::NoError) {
+                emit preItemsReset();
+                m_groups = p_db->getAllGroupsInfo();
+                emit postItemsReset();
+
+                if (m_groups.isEmpty()) {
+                    p_logger->warn("No group items from database");
+                    return;
+                } else {
+                    m_origin_groups = m_groups;
+                }
+            }
 
-    p_nodes->reloadItems();
-}
+            p_nodes->reloadItems();
 
-bool GroupList::insertSIP008(const GroupInfo &group_info,
-                             const QString &content) {
-    if (p_db == nullptr)
-        return false;
+            if (after)
+                after();
+        });
+}
 
+std::optional<QList<NodeInfo>>
+GroupList::parseSIP008(const GroupInfo &group_info, const QString &content) {
     auto meta_objects = SerializeTools::sip008Parser(content.toStdString());
     if (!meta_objects.has_value()) {
         p_logger->error("Failed to parse download subscription");
-        return false;
+        return {};
     }
 
     QList<NodeInfo> nodes;
@@ -289,54 +470,53 @@ bool GroupList::insertSIP008(const GroupInfo &group_info,
             .raw =
                 QString::fromStdString(SerializeTools::MessageToJson(outbound)),
             .url = QString(url.toEncoded()),
+            .outbound = SerializeTools::MessageToBytes(outbound),
         };
 
         nodes.append(node);
     }
 
-    if (auto err = p_db->insert(nodes); err.type() != QSqlError::NoError) {
-        return false;
-    }
-
-    reloadItems();
-    return true;
+    return nodes;
 }
 
-bool GroupList::insertBase64(const GroupInfo &group_info,
-                             const QString &content) {
-    if (p_db == nullptr)
-        return false;
+std::optional<QList<NodeInfo>>
+GroupList::parseBase64(const GroupInfo &group_info, const QString &content) {
+    QList<QStringList> chunks;
+    bool is_ended = false;
 
-    QString temp_data;
-    if (!content.contains("://"))
-        temp_data = QByteArray::fromBase64(content.toUtf8());
-    else
-        temp_data = content;
+    network::LineDecoder decoder([&](const std::string &line) {
+        // the listing ends at the first empty line
+        if (is_ended || line.empty()) {
+            is_ended = true;
+            return;
+        }
 
-    QList<NodeInfo> nodes;
-    for (auto &item : temp_data.split("\n")) {
-        item.remove("\r");
-        if (item.isEmpty())
-            break;
+        if (chunks.isEmpty() ||
+            chunks.last().size() == SubscriptionStream::CHUNK_SIZE)
+            chunks.append(QStringList());
+        chunks.last().append(QString::fromStdString(line));
+    });
+
+    auto bytes = content.toUtf8();
+    decoder.feed(bytes.constData(), static_cast<size_t>(bytes.size()));
+    decoder.finish();
+
+    // mapped results keep the order of the chunks
+    auto decoded =
+        QtConcurrent::blockingMapped<QList<std::optional<QList<NodeInfo>>>>(
+            chunks, [group_info](const QStringList &lines) {
+                return SubscriptionStream::decode(group_info, lines);
+            });
 
-        NodeInfo node = {
-            .group_id = group_info.id,
-            .group_name = group_info.name,
-            .routing_id = 0,
-            .routing_name = "default_routings",
-        };
+    QList<NodeInfo> nodes;
+    for (auto &chunk : decoded) {
+        if (!chunk.has_value())
+            return {};
 
-        if (!SerializeTools::decodeOutboundFromURL(node, item.toStdString()))
-            return false;
-        else
-            nodes.append(node);
+        nodes.append(chunk.value());
     }
 
-    if (auto result = p_db->insert(nodes); result.type() != QSqlError::NoError)
-        return false;
-
-    reloadItems();
-    return true;
+    return nodes;
 }
 
 void GroupList::appendItem(const QString &group_name, const QString &url,
@@ -347,8 +527,6 @@ void GroupList::appendItem(const QString &group_name, const QString &url,
         .user_agent = p_config->networkUserAgent(),
     };
 
-    p_nodes->setDownloadProxy(task);
-
     GroupInfo group_info = {
         .name = group_name,
         .is_subscription = true,
@@ -359,7 +537,7 @@ void GroupList::appendItem(const QString &group_name, const QString &url,
 
     m_pre_groups.append(group_info);
 
-    p_curl->download(task);
+    download(task, group_info.type);
 }
 
 void GroupList::appendItem(const QString &group_name,
@@ -370,14 +548,20 @@ void GroupList::appendItem(const QString &group_name,
         .type = base64,
     };
 
-    if (auto result = p_db->insert(group_info);
-        result.type() != QSqlError::NoError) {
-        return;
-    }
+    p_db->insertAsync(group_info)
+        .then(this, [this, group_info, node_items](
+                        const QPair<QSqlError, qint64> &result) {
+            if (result.first.type() != QSqlError::NoError)
+                return;
 
-    if (!insert(group_info, node_items)) {
-        p_logger->error("Failed to parse url");
-    }
+            auto group = group_info;
+            group.id = result.second;
+
+            insert(group, node_items, [this](bool is_inserted) {
+                if (!is_inserted)
+                    p_logger->error("Failed to parse url");
+            });
+        });
 }
 
 void GroupList::editItem(int index, const QString &group_name,
@@ -406,30 +590,27 @@ void GroupList::editItem(int index, const QString &group_name,
 
     m_groups[index] = group;
 
-    if (auto result = p_db->update(group);
-        result.type() == QSqlError::NoError) {
-        if (auto result = p_db->removeGroupFromID(group.id, true);
-            result.type() != QSqlError::NoError)
-            return;
-    } else {
-        return;
-    }
-
-    if (is_url_changed) {
-        DownloadTask task = {
-            .id = group.id,
-            .name = group.name,
-            .url = group.url,
-            .user_agent = p_config->networkUserAgent(),
-            .is_updated = true,
-        };
-
-        p_nodes->setDownloadProxy(task);
-
-        p_curl->download(task);
-    } else if (!node_items.isEmpty()) {
-        this->insertBase64(group, node_items);
-    }
+    p_db->updateAsync(group).then(
+        this,
+        [this, group, is_url_changed, node_items](const QSqlError &result) {
+            if (result.type() != QSqlError::NoError)
+                return;
+
+            if (is_url_changed) {
+                DownloadTask task = {
+                    .id = group.id,
+                    .name = group.name,
+                    .url = group.url,
+                    .user_agent = p_config->networkUserAgent(),
+                    .is_updated = true,
+                };
+
+                download(task, group.type);
+            } else {
+                // an emptied listing removes every node of the group
+                this->sync(group, node_items);
+            }
+        });
 }
 
 void GroupList::removeItem(int index) {
@@ -462,77 +643,127 @@ void GroupList::copyUrlToClipboard(int index) {
 void GroupList::copyNodesToClipboard(int index) {
     auto item = m_groups.at(index);
 
-    QString nodes_url;
-    for (auto &node : p_db->listAllNodesFromGroupID(item.id)) {
-        nodes_url.append(node.url);
-        nodes_url.append("\n");
-    }
+    p_db->listAllNodesFromGroupIDAsync(item.id).then(
+        this, [this, item](const QList<NodeInfo> &nodes) {
+            QString nodes_url;
+            for (auto &node : nodes) {
+                nodes_url.append(node.url);
+                nodes_url.append("\n");
+            }
 
 #if defined(Q_CC_MINGW) || defined(Q_OS_MACOS)
-    NotifyTools::send(nodes_url,
-                      QString(tr("Copy [%1] URL to clipboard")).arg(item.name),
-                      p_tray);
+            NotifyTools::send(
+                nodes_url,
+                QString(tr("Copy [%1] URL to clipboard")).arg(item.name),
+                p_tray);
 #else
-    NotifyTools::send(nodes_url,
-                      QString(tr("Copy [%1] URL to clipboard")).arg(item.name));
+            NotifyTools::send(
+                nodes_url,
+                QString(tr("Copy [%1] URL to clipboard")).arg(item.name));
 #endif
 
-    ClipboardTools::send(nodes_url);
+            ClipboardTools::send(nodes_url);
+        });
 }
 
 void GroupList::handleDownloaded(const QVariant &content) {
     auto task = content.value<DownloadTask>();
-    if (task.content.isEmpty()) {
+    auto stream = std::dynamic_pointer_cast<SubscriptionStream>(task.sink);
+    if (task.content.isEmpty() &&
+        (stream == nullptr || !stream->isFinished())) {
         if (task.is_updated)
             m_is_updating.remove(task.id);
         return;
     }
 
     if (task.is_updated) {
-        QList<GroupInfo> temp_groups;
-        for (auto &item : m_groups) {
-            if (item.id == task.id) {
-                auto group = item;
-                if (auto result = p_db->removeGroupFromID(group.id, true);
-                    result.type() != QSqlError::NoError)
-                    break;
-                if (!insert(group, task.content))
-                    break;
-
-                temp_groups.append(group);
-                break;
-            }
-        }
-
-        if (auto result = p_db->update(temp_groups);
-            result.type() != QSqlError::NoError) {
+        auto iter = std::find_if(
+            m_groups.cbegin(), m_groups.cend(),
+            [&task](const GroupInfo &item) { return item.id == task.id; });
+        if (iter == m_groups.cend()) {
             m_is_updating.remove(task.id);
             return;
-        } else {
-            p_db->updateRuntimeValue(
-                RuntimeValue(RunTimeValues::DEFAULT_NODE_ID, 0));
         }
 
-        m_is_updating.remove(task.id);
-    } else {
-        for (auto i = 0; i < m_pre_groups.size(); ++i) {
-            if (m_pre_groups.at(i).name == task.name) {
-                auto group = m_pre_groups.at(i);
-
-                if (auto result = p_db->insert(group);
-                    result.type() != QSqlError::NoError)
-                    break;
+        auto group = *iter;
+        parseDownloaded(group, task)
+            .then(this, [this, group](std::optional<QList<NodeInfo>> nodes) {
+                if (!nodes.has_value()) {
+                    p_logger->error("Failed to parse subscription: {}",
+                                    group.name.toStdString());
+                    m_is_updating.remove(group.id);
+                    return;
+                }
+
+                importItems(group, nodes.value());
+            });
 
-                if (!insert(group, task.content))
-                    break;
+        return;
+    }
 
-                m_pre_groups.remove(i);
-                break;
-            }
+    for (auto i = 0; i < m_pre_groups.size(); ++i) {
+        if (m_pre_groups.at(i).name == task.name) {
+            p_db->insertAsync(m_pre_groups.at(i))
+                .then(this, [this, group = m_pre_groups.at(i), task](
+                                const QPair<QSqlError, qint64> &result) {
+                    if (result.first.type() != QSqlError::NoError)
+                        return;
+
+                    auto inserted = group;
+                    inserted.id = result.second;
+
+                    // the group shows up before its nodes are parsed
+                    reloadItems();
+
+                    insertItems(parseDownloaded(inserted, task),
+                                [this, inserted](bool is_inserted) {
+                                    if (!is_inserted)
+                                        return;
+
+                                    m_pre_groups.removeIf(
+                                        [&inserted](const GroupInfo &item) {
+                                            return item.name == inserted.name;
+                                        });
+                                });
+                });
+            break;
         }
     }
+}
+
+void GroupList::importItems(const GroupInfo &group_info,
+                            const QList<NodeInfo> &nodes) {
+    // the old nodes stay visible until the import swaps in the new ones
+    p_db->importGroup(group_info.id, nodes)
+        .then(this, [this, group_info](
+                        const QPair<QSqlError, GroupSyncDelta> &result) {
+            auto &[error, delta] = result;
+            m_is_updating.remove(group_info.id);
+
+            if (error.type() != QSqlError::NoError) {
+                p_logger->error("Failed to import group {}: {}",
+                                group_info.name.toStdString(),
+                                error.text().toStdString());
+                return;
+            }
+
+            p_logger->info("Imported group {}: {} added, {} updated, {} "
+                           "removed, {} unchanged",
+                           group_info.name.toStdString(), delta.inserted,
+                           delta.updated, delta.removed, delta.unchanged);
+
+            p_db->updateAsync(group_info)
+                .then(this, [this](const QSqlError &res) {
+                    if (res.type() != QSqlError::NoError)
+                        return;
+
+                    // IDs survive an import, only forget the default node
+                    // once it is gone
+                    p_db->clearMissingDefaultNode();
 
-    reloadItems();
+                    reloadItems();
+                });
+        });
 }
 
 void GroupList::handleItemsChanged(int64_t group_id, int size) {
@@ -1,12 +1,16 @@
 #ifndef ACROSS_GROUPLIST_H
 #define ACROSS_GROUPLIST_H
 
+#include <functional>
 #include <memory>
 
 #include "magic_enum.hpp"
 #include <QObject>
 #include <QPointer>
 #include <QVariant>
+#include <QtConcurrent>
+
+#include <atomic>
 
 #if defined(Q_CC_MINGW) || defined(Q_OS_MACOS)
 #include <QSystemTrayIcon>
@@ -25,6 +29,36 @@
 
 namespace across {
 
+// parses a base64 subscription while it downloads, every full chunk of
+// share links is decoded on the thread pool as soon as it arrives
+class SubscriptionStream : public network::DownloadSink {
+  public:
+    static constexpr qsizetype CHUNK_SIZE = 256;
+
+    SubscriptionStream();
+
+    void write(const char *data, size_t size) override;
+    void finish() override;
+    [[nodiscard]] bool isFinished() const;
+
+    // waits for the pending chunks, nodes are assigned to the group here
+    // because a new group has no ID while it downloads
+    std::optional<QList<NodeInfo>> result(const GroupInfo &group_info);
+
+    static std::optional<QList<NodeInfo>> decode(const GroupInfo &group_info,
+                                                 const QStringList &lines);
+
+  private:
+    void dispatch();
+
+    network::LineDecoder m_decoder;
+    QStringList m_lines;
+    QList<QFuture<std::optional<QList<NodeInfo>>>> m_chunks;
+    // the listing ends at the first empty line
+    bool m_is_ended = false;
+    std::atomic<bool> m_is_finished = false;
+};
+
 class GroupList : public QObject {
     Q_OBJECT
   public:
@@ -37,9 +71,20 @@ class GroupList : public QObject {
               QSharedPointer<across::NotificationModel> notifications,
               const QSharedPointer<QSystemTrayIcon> &tray = nullptr);
 
-    bool insert(const GroupInfo &group_info, const QString &content);
-    bool insertSIP008(const GroupInfo &group_info, const QString &content);
-    bool insertBase64(const GroupInfo &group_info, const QString &content);
+    // content is parsed on the thread pool, the nodes are written once it
+    // is done
+    void insert(const GroupInfo &group_info, const QString &content,
+                std::function<void(bool)> after = [](bool) {});
+    void sync(const GroupInfo &group_info, const QString &content);
+
+    std::optional<QList<NodeInfo>> parse(const GroupInfo &group_info,
+                                         const QString &content);
+    QFuture<std::optional<QList<NodeInfo>>>
+    parseAsync(const GroupInfo &group_info, const QString &content);
+    std::optional<QList<NodeInfo>> parseSIP008(const GroupInfo &group_info,
+                                               const QString &content);
+    std::optional<QList<NodeInfo>> parseBase64(const GroupInfo &group_info,
+                                               const QString &content);
 
     QList<GroupInfo> items() const;
 
@@ -69,7 +114,7 @@ class GroupList : public QObject {
     void handleDownloaded(const QVariant &content);
     void handleItemsChanged(int64_t group_id, int size);
     void handleNodeLatencyChanged(qint64 group_id, int index,
-                                  const across::NodeInfo &node);
+                                  const across::NodeSummary &node);
 
   signals:
     void preItemsReset();
@@ -77,9 +122,21 @@ class GroupList : public QObject {
 
     void itemInfoChanged(int index);
     void nodeLatencyChanged(qint64 group_id, int index,
-                            const across::NodeInfo &node);
+                            const across::NodeSummary &node);
 
   private:
+    // the groups are read off the GUI thread, after runs once they are shown
+    void loadGroups(const std::function<void()> &after = {});
+    void showSearchResults(const QList<SearchResult> &results);
+    void importItems(const GroupInfo &group_info,
+                     const QList<NodeInfo> &nodes);
+    void insertItems(QFuture<std::optional<QList<NodeInfo>>> parsing,
+                     const std::function<void(bool)> &after);
+    QFuture<std::optional<QList<NodeInfo>>>
+    parseDownloaded(const GroupInfo &group_info,
+                    const network::DownloadTask &task);
+    void download(network::DownloadTask task, SubscriptionType type);
+
     QSharedPointer<across::setting::ConfigTools> p_config;
     QSharedPointer<across::DBTools> p_db;
     QSharedPointer<across::NodeList> p_nodes;
@@ -97,6 +154,7 @@ class GroupList : public QObject {
     QMap<int64_t, int> m_tcpPinging_count;
     QMap<int64_t, int> m_group_size;
     QMap<int64_t, Notification *> m_tcpPinging_notifications;
+    quint64 m_search_serial = 0;
 };
 } // namespace across
 
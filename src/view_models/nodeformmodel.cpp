@@ -12,12 +12,9 @@ void NodeFormModel::accept(const QVariantMap &values) {
     if (values.contains("nodeID")) {
         qint64 node_id = values.value("nodeID").toLongLong();
 
-        for (auto &item : p_list->items()) {
-            if (node_id == item.id) {
-                node = item;
-                is_new = false;
-                break;
-            }
+        if (auto item = p_list->getNodeByID(node_id); item.has_value()) {
+            node = item.value();
+            is_new = false;
         }
     }
 
@@ -60,12 +57,8 @@ QString NodeFormModel::refreshPreview(const QVariantMap &values) {
     if (values.contains("nodeID")) {
         qint64 node_id = values.value("nodeID").toLongLong();
 
-        for (auto &item : p_list->items()) {
-            if (node_id == item.id) {
-                node = item;
-                break;
-            }
-        }
+        if (auto item = p_list->getNodeByID(node_id); item.has_value())
+            node = item.value();
     }
 
     auto result = false;
@@ -188,6 +181,7 @@ bool NodeFormModel::setTrojanOutbound(NodeInfo &node,
     }
 
     node.raw = SerializeTools::MessageToJson(*outbound).c_str();
+    node.outbound = SerializeTools::MessageToBytes(*outbound);
     if (node.raw.isEmpty())
         return false;
 
@@ -230,6 +224,7 @@ bool NodeFormModel::setShadowsocksOutbound(NodeInfo &node,
         return false;
 
     node.raw = SerializeTools::MessageToJson(*outbound).c_str();
+    node.outbound = SerializeTools::MessageToBytes(*outbound);
     if (node.raw.isEmpty())
         return false;
 
@@ -360,6 +355,7 @@ bool NodeFormModel::setVMessOutboud(NodeInfo &node, const QVariantMap &values) {
     } while (false);
 
     node.raw = SerializeTools::MessageToJson(*outbound).c_str();
+    node.outbound = SerializeTools::MessageToBytes(*outbound);
     if (node.raw.isEmpty())
         return false;
 
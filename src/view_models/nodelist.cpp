@@ -1,5 +1,6 @@
 #include "nodelist.h"
 
+#include <algorithm>
 #include <utility>
 
 using namespace across;
@@ -12,6 +13,8 @@ using namespace across::network;
 NodeList::NodeList(QObject *parent) : QObject(parent) {}
 
 NodeList::~NodeList() {
+    flushTraffic();
+
     while (!m_tasks.isEmpty())
         m_tasks.dequeue().cancel();
 }
@@ -39,19 +42,19 @@ void NodeList::init(QSharedPointer<across::setting::ConfigTools> config,
             p_api->stopMonitoring();
         else {
             if (p_core->isRunning() && p_api != nullptr) {
+                flushTraffic();
                 p_api->restartMonitoring();
-                m_traffic_last.clear();
-                m_traffic_sum.clear();
+                resetTrafficBaseline(false);
             }
         }
     });
 
     connect(p_config.get(), &ConfigTools::apiPortChanged, this, [&]() {
         if (p_api != nullptr) {
+            flushTraffic();
             p_api->stopMonitoring();
             p_api.reset(new APITools(p_config->apiPort().toUInt()));
-            m_traffic_last.clear();
-            m_traffic_sum.clear();
+            resetTrafficBaseline(!p_core->isRunning());
         }
     });
 
@@ -60,9 +63,9 @@ void NodeList::init(QSharedPointer<across::setting::ConfigTools> config,
             if (p_core->isRunning()) {
                 p_api->startMonitoring("PROXY");
             } else {
+                flushTraffic();
                 p_api->stopMonitoring();
-                m_traffic_last.clear();
-                m_traffic_sum.clear();
+                resetTrafficBaseline(true);
             }
         }
     });
@@ -70,6 +73,11 @@ void NodeList::init(QSharedPointer<across::setting::ConfigTools> config,
     connect(this, &NodeList::itemLatencyChanged, this,
             &NodeList::handleLatencyChanged);
 
+    m_traffic_timer.setInterval(TRAFFIC_FLUSH_INTERVAL);
+    connect(&m_traffic_timer, &QTimer::timeout, this,
+            &NodeList::flushTraffic);
+    m_traffic_timer.start();
+
     if (p_config->apiEnable()) {
         p_api = QSharedPointer<APITools>::create(p_config->apiPort().toUInt());
 
@@ -77,6 +85,27 @@ void NodeList::init(QSharedPointer<across::setting::ConfigTools> config,
                 [this](const QVariant &data) {
                     auto traffic = data.value<TrafficInfo>();
 
+                    // monitoring restarted on a running core, its totals
+                    // still hold what was counted before
+                    if (!m_has_traffic_baseline) {
+                        m_traffic_last = traffic;
+                        m_has_traffic_baseline = true;
+                        return;
+                    }
+
+                    // stats are cumulative per core run, a smaller value
+                    // means the counters were reset
+                    // without a current node there is no row to charge
+                    auto upload = traffic.upload - m_traffic_last.upload;
+                    auto download = traffic.download - m_traffic_last.download;
+                    if (m_node.id != 0) {
+                        m_pending_traffic.node_id = m_node.id;
+                        m_pending_traffic.upload +=
+                            upload < 0 ? traffic.upload : upload;
+                        m_pending_traffic.download +=
+                            download < 0 ? traffic.download : download;
+                    }
+
                     m_traffic_sum.download += traffic.download -
                                               m_traffic_last.download -
                                               m_traffic_last_rate.download;
@@ -101,22 +130,12 @@ void NodeList::init(QSharedPointer<across::setting::ConfigTools> config,
         NodeInfo node;
 
         if (auto id = p_db->getCurrentNodeID(); id) {
-            auto nodes =
-                p_db->listAllNodesFromGroupID(p_db->getCurrentGroupID());
-            for (auto &nodeItem : nodes) {
-                if (id == nodeItem.id) {
-                    node = nodeItem;
-                }
-            }
+            if (auto item = p_db->getNodeByID(id); item.has_value())
+                node = item.value();
         }
         if (auto id = p_db->getDefaultNodeID(); id) {
-            auto nodes =
-                p_db->listAllNodesFromGroupID(p_db->getDefaultGroupID());
-            for (auto &nodeItem : nodes) {
-                if (id == nodeItem.id) {
-                    node = nodeItem;
-                }
-            }
+            if (auto item = p_db->getNodeByID(id); item.has_value())
+                node = item.value();
         }
         m_node = node;
         if (!run()) {
@@ -136,7 +155,7 @@ void NodeList::init(QSharedPointer<across::setting::ConfigTools> config,
 bool NodeList::run() {
     bool res = false;
     do {
-        if (m_node.raw.isEmpty()) {
+        if (m_node.raw.isEmpty() && m_node.outbound.isEmpty()) {
             p_logger->error("Failed to load current node");
             break;
         }
@@ -162,53 +181,133 @@ bool NodeList::run() {
     return res;
 }
 
-void NodeList::setFilter(const QMap<qint64, QList<qint64>> &search_results) {
+void NodeList::setFilter(const QMap<qint64, QList<qint64>> &search_results,
+                         qint64 group_id) {
     if (search_results.isEmpty())
         return;
 
+    // kept in rank order, pages are put back into it once read
     m_search_results = search_results;
-    setDisplayGroupID(m_search_results.firstKey());
+
+    if (!m_search_results.contains(group_id))
+        group_id = m_search_results.firstKey();
+
+    // the filter and the group switch share a single reload
+    bool is_group_changed = group_id != m_display_group_id;
+    m_display_group_id = group_id;
+
+    reloadItems();
+    if (is_group_changed)
+        emit displayGroupIDChanged();
 }
 
 void NodeList::clearFilter() {
     m_search_results.clear();
 
-    emit preItemsReset();
-    m_nodes = m_origin_nodes;
-    emit postItemsReset();
+    reloadItems();
 }
 
 void NodeList::clearItems() {
+    ++m_generation;
+    m_has_more = false;
+    m_is_fetching = false;
+
     emit preItemsReset();
     m_nodes.clear();
     emit postItemsReset();
 }
 
-QList<NodeInfo> NodeList::items() { return m_nodes; }
+QList<NodeSummary> NodeList::items() { return m_nodes; }
 
-void NodeList::reloadItems() {
-    emit preItemsReset();
-    m_nodes = p_db->listAllNodesFromGroupID(displayGroupID());
-    m_origin_nodes = m_nodes;
-
-    if (!m_search_results.isEmpty() &&
-        m_search_results.contains(m_display_group_id)) {
-        QList<NodeInfo> temp_nodes;
-        auto nodes_id = m_search_results.value(m_display_group_id);
-        auto iter = m_origin_nodes.begin();
-        for (auto &node_id : nodes_id) {
-            for (; iter != m_origin_nodes.end(); ++iter) {
-                if (iter->id == node_id) {
-                    temp_nodes.append(*iter);
-                    ++iter;
-                    break;
+std::optional<NodeInfo> NodeList::getNodeByID(qint64 node_id) {
+    return p_db->getNodeByID(node_id);
+}
+
+void NodeList::reloadItems(std::function<void()> after) {
+    auto group_id = displayGroupID();
+    auto generation = ++m_generation;
+    m_is_fetching = true;
+
+    nextPage(group_id, 0).then(
+        this, [this, group_id, generation, after{std::move(after)}](
+                  const QList<NodeSummary> &nodes) {
+            // drop stale results if the listing has been reloaded since
+            if (generation != m_generation || group_id != displayGroupID())
+                return;
+
+            m_is_fetching = false;
+
+            emit preItemsReset();
+            m_nodes = nodes;
+            m_has_more = hasMore(group_id, nodes.size());
+            emit postItemsReset();
+
+            after();
+        });
+}
+
+bool NodeList::canFetchMore() const { return m_has_more && !m_is_fetching; }
+
+void NodeList::fetchMore() {
+    if (!canFetchMore())
+        return;
+
+    auto group_id = displayGroupID();
+    auto generation = m_generation;
+    m_is_fetching = true;
+
+    nextPage(group_id, m_nodes.size())
+        .then(this, [this, group_id, generation](
+                        const QList<NodeSummary> &nodes) {
+            if (generation != m_generation || group_id != displayGroupID())
+                return;
+
+            m_is_fetching = false;
+
+            emit preItemsReset();
+            m_nodes.append(nodes);
+            m_has_more = hasMore(group_id, nodes.size());
+            emit postItemsReset();
+        });
+}
+
+QFuture<QList<NodeSummary>> NodeList::nextPage(qint64 group_id,
+                                               qsizetype offset) {
+    if (isFiltered(group_id)) {
+        auto nodes_id = m_search_results.value(group_id).mid(offset, PAGE_SIZE);
+
+        return p_db->listNodeSummariesFromIDs(nodes_id).then(
+            [nodes_id](const QList<NodeSummary> &nodes) {
+                QHash<qint64, NodeSummary> by_id;
+                for (auto &node : nodes)
+                    by_id.insert(node.id, node);
+
+                QList<NodeSummary> ranked;
+                ranked.reserve(nodes.size());
+                for (auto &node_id : nodes_id) {
+                    if (auto iter = by_id.constFind(node_id);
+                        iter != by_id.cend())
+                        ranked.append(iter.value());
                 }
-            }
-        }
 
-        m_nodes = temp_nodes;
+                return ranked;
+            });
     }
-    emit postItemsReset();
+
+    qint64 after_id = offset > 0 ? m_nodes.last().id : 0;
+
+    return p_db->listNodeSummariesPage(group_id, after_id, PAGE_SIZE);
+}
+
+bool NodeList::isFiltered(qint64 group_id) const {
+    return m_search_results.contains(group_id);
+}
+
+bool NodeList::hasMore(qint64 group_id, qsizetype received) const {
+    if (isFiltered(group_id))
+        return m_nodes.size() < m_search_results.value(group_id).size();
+
+    return received == PAGE_SIZE;
 }
 
 QString NodeList::generateConfig() {
@@ -224,10 +323,15 @@ QString NodeList::generateConfig() {
             across::SerializeTools::ConfigToJson(node_config, m_node.raw));
     } else {
         auto outbound = node_config.add_outbounds();
-        auto temp_outbound =
-            across::SerializeTools::JsonToOutbound(m_node.raw.toStdString());
 
-        outbound->CopyFrom(temp_outbound);
+        // stored nodes carry the serialized message, no JSON parse needed
+        if (!m_node.outbound.isEmpty()) {
+            outbound->ParseFromArray(m_node.outbound.constData(),
+                                     static_cast<int>(m_node.outbound.size()));
+        } else {
+            outbound->CopyFrom(across::SerializeTools::JsonToOutbound(
+                m_node.raw.toStdString()));
+        }
 
         if (outbound->tag().empty()) {
             outbound->set_tag("PROXY");
@@ -256,57 +360,194 @@ void NodeList::appendNode(NodeInfo node) {
     node.routing_id = 0;
     node.routing_name = "default_routings";
 
-    if (auto err = p_db->insert(node); err.type() != QSqlError::NoError) {
-        p_logger->error("Failed to add node: {}", node.name.toStdString());
-    } else {
+    p_db->insertAsync(node).then(this, [this, node](const QSqlError &result) {
+        if (result.type() != QSqlError::NoError) {
+            p_logger->error("Failed to add node: {}", node.name.toStdString());
+            return;
+        }
+
         reloadItems();
-        emit groupSizeChanged(node.group_id, m_nodes.size());
-    }
+        refreshGroupSize(node.group_id);
+    });
 }
 
 void NodeList::updateNode(NodeInfo node) {
     node.modified_time = QDateTime::currentDateTime();
 
-    if (auto err = p_db->update(node); err.type() != QSqlError::NoError) {
-        p_logger->error("Failed to update node info: {}",
-                        node.name.toStdString());
-    } else {
-        reloadItems();
+    p_db->updateAsync(node).then(
+        this, [this, name = node.name](const QSqlError &result) {
+            if (result.type() != QSqlError::NoError) {
+                p_logger->error("Failed to update node info: {}",
+                                name.toStdString());
+                return;
+            }
+
+            reloadItems();
+        });
+}
+
+void NodeList::removeNodeByID(int id) { removeNodes({id}); }
+
+QList<qint64> NodeList::toNodesID(const QVariantList &values) {
+    QList<qint64> nodes_id;
+    nodes_id.reserve(values.size());
+    for (auto &value : values)
+        nodes_id.append(value.toLongLong());
+
+    return nodes_id;
+}
+
+void NodeList::removeNodes(const QVariantList &values) {
+    auto nodes_id = toNodesID(values);
+    if (nodes_id.isEmpty())
+        return;
+
+    p_db->removeNodes(nodes_id).then(
+        this, [this, nodes_id](const QSqlError &result) {
+            if (result.type() != QSqlError::NoError) {
+                p_logger->error("Failed to remove {} nodes: {}",
+                                nodes_id.size(), result.text().toStdString());
+                return;
+            }
+
+            dropNodes(nodes_id, {displayGroupID()});
+        });
+}
+
+void NodeList::moveNodes(const QVariantList &values, qint64 group_id) {
+    auto nodes_id = toNodesID(values);
+    if (nodes_id.isEmpty())
+        return;
+
+    // the source groups are only known before the rows move, a search
+    // result may hold nodes of several groups
+    QSet<qint64> groups_id = {displayGroupID(), group_id};
+    QSet<qint64> moved(nodes_id.cbegin(), nodes_id.cend());
+    for (auto &node : m_nodes) {
+        if (moved.contains(node.id))
+            groups_id.insert(node.group_id);
     }
+
+    p_db->moveNodes(nodes_id, group_id)
+        .then(this, [this, nodes_id, group_id,
+                     groups_id](const QSqlError &result) {
+            if (result.type() != QSqlError::NoError) {
+                p_logger->error("Failed to move {} nodes to group {}: {}",
+                                nodes_id.size(), group_id,
+                                result.text().toStdString());
+                return;
+            }
+
+            if (group_id != displayGroupID()) {
+                dropNodes(nodes_id, groups_id);
+                return;
+            }
+
+            reloadItems();
+            for (auto &id : groups_id)
+                refreshGroupSize(id);
+        });
 }
 
-void NodeList::removeNodeByID(int id) {
-    for (const auto &node : m_nodes) {
-        if (id == node.id) {
-            auto group_id = node.group_id;
-            if (auto result = p_db->removeNodeFromID(id);
-                result.type() != QSqlError::NoError) {
-                p_logger->error("Failed to remove node: {}", id);
-            } else {
+void NodeList::copyNodes(const QVariantList &values, qint64 group_id) {
+    auto nodes_id = toNodesID(values);
+    if (nodes_id.isEmpty())
+        return;
+
+    p_db->copyNodes(nodes_id, group_id)
+        .then(this, [this, nodes_id, group_id](const QSqlError &result) {
+            if (result.type() != QSqlError::NoError) {
+                p_logger->error("Failed to copy {} nodes to group {}: {}",
+                                nodes_id.size(), group_id,
+                                result.text().toStdString());
+                return;
+            }
+
+            if (group_id == displayGroupID())
                 reloadItems();
+
+            refreshGroupSize(group_id);
+        });
+}
+
+void NodeList::setNodesRouting(const QVariantList &values,
+                               qint64 routing_id) {
+    auto nodes_id = toNodesID(values);
+    if (nodes_id.isEmpty())
+        return;
+
+    p_db->updateRouting(nodes_id, routing_id)
+        .then(this, [this, nodes_id, routing_id](
+                        const QPair<QSqlError, QString> &result) {
+            auto &[error, routing_name] = result;
+            if (error.type() != QSqlError::NoError) {
+                p_logger->error("Failed to set routing {} on {} nodes: {}",
+                                routing_id, nodes_id.size(),
+                                error.text().toStdString());
+                return;
             }
-            emit groupSizeChanged(group_id, m_nodes.size());
-            break;
-        }
+
+            // the routing roles are served from the loaded rows
+            QSet<qint64> updated(nodes_id.cbegin(), nodes_id.cend());
+            for (auto &node : m_nodes) {
+                if (updated.contains(node.id)) {
+                    node.routing_id = routing_id;
+                    node.routing_name = routing_name;
+                }
+            }
+
+            emit preItemsReset();
+            emit postItemsReset();
+        });
+}
+
+void NodeList::dropNodes(const QList<qint64> &nodes_id,
+                         QSet<qint64> groups_id) {
+    QSet<qint64> dropped(nodes_id.cbegin(), nodes_id.cend());
+    auto is_dropped = [&dropped](qint64 node_id) {
+        return dropped.contains(node_id);
+    };
+
+    for (auto &node : m_nodes) {
+        if (is_dropped(node.id))
+            groups_id.insert(node.group_id);
     }
+
+    // loaded rows are a prefix of the filter, so both shrink together
+    for (auto &filtered : m_search_results)
+        filtered.removeIf(is_dropped);
+
+    emit preItemsReset();
+    m_nodes.removeIf(
+        [&is_dropped](const NodeSummary &node) { return is_dropped(node.id); });
+    emit postItemsReset();
+
+    for (auto &group_id : groups_id)
+        refreshGroupSize(group_id);
+}
+
+void NodeList::refreshGroupSize(qint64 group_id) {
+    p_db->getSizeFromGroupID(group_id).then(
+        this, [this, group_id](qsizetype size) {
+            emit groupSizeChanged(group_id, static_cast<int>(size));
+        });
 }
 
 QVariantMap NodeList::getNodeInfoByIndex(int index) {
     if (index >= m_nodes.size())
         return {};
 
-    auto node = m_nodes.at(index);
+    if (auto node = getNodeByID(m_nodes.at(index).id); node.has_value())
+        return node->toVariantMap();
 
-    return node.toVariantMap();
+    return {};
 }
 
 QString NodeList::getQRCode(int node_id, int group_id) {
-    auto nodes = p_db->listAllNodesFromGroupID(group_id);
-    for (auto &node : nodes) {
-        if (node.id == node_id) {
-            emit updateQRCode(node.name, node.url);
-            return node.name;
-        }
+    if (auto node = getNodeByID(node_id);
+        node.has_value() && node->group_id == group_id) {
+        emit updateQRCode(node->name, node->url);
+        return node->name;
     }
 
     return "";
@@ -319,12 +560,56 @@ qint64 NodeList::currentGroupID() const { return m_node.group_id; }
 qint64 NodeList::displayGroupID() const { return m_display_group_id; }
 
 Q_INVOKABLE qint64 NodeList::getIndexByNode(qint64 node_id, qint64 group_id) {
-    auto nodes = p_db->listAllNodesFromGroupID(group_id);
-    for (qint64 index = 0; index < nodes.size(); index++) {
-        if (node_id == nodes.at(index).id) {
-            return index;
+    if (group_id == displayGroupID()) {
+        for (qint64 index = 0; index < m_nodes.size(); index++) {
+            if (node_id == m_nodes.at(index).id)
+                return index;
         }
+
+        if (isFiltered(group_id))
+            return -1;
     }
+
+    auto generation = m_generation;
+    p_db->getNodeIndex(group_id, node_id)
+        .then(this, [this, group_id, generation](qint64 index) {
+            if (index < 0 || generation != m_generation ||
+                group_id != displayGroupID())
+                return;
+
+            if (index < m_nodes.size()) {
+                emit nodeLocated(index);
+                return;
+            }
+
+            if (m_is_fetching)
+                return;
+
+            // load the rows up to the node so the view is able to scroll
+            // to it
+            m_is_fetching = true;
+            qint64 after_id = m_nodes.isEmpty() ? 0 : m_nodes.last().id;
+            auto limit = static_cast<int>(index - m_nodes.size() + PAGE_SIZE);
+
+            p_db->listNodeSummariesPage(group_id, after_id, limit)
+                .then(this, [this, group_id, generation, index,
+                             limit](const QList<NodeSummary> &nodes) {
+                    if (generation != m_generation ||
+                        group_id != displayGroupID())
+                        return;
+
+                    m_is_fetching = false;
+
+                    emit preItemsReset();
+                    m_nodes.append(nodes);
+                    m_has_more = nodes.size() == limit;
+                    emit postItemsReset();
+
+                    if (index < m_nodes.size())
+                        emit nodeLocated(index);
+                });
+        });
+
     return -1;
 }
 
@@ -372,14 +657,29 @@ void NodeList::setDisplayGroupID(int group_id) {
 }
 
 void NodeList::setCurrentNodeByID(int id) {
-    for (auto &node : m_nodes) {
-        if (id == node.id) {
-            m_node = node;
+    auto iter = std::find_if(m_nodes.cbegin(), m_nodes.cend(),
+                             [id](const NodeSummary &item) {
+                                 return item.id == id;
+                             });
+    if (iter == m_nodes.cend())
+        return;
+
+    p_db->getNodeByIDAsync(id).then(
+        this, [this, id](const std::optional<NodeInfo> &node) {
+            if (!node.has_value()) {
+                p_logger->error("Failed to load node info: {}", id);
+                return;
+            }
+
+            // usage so far belongs to the node being replaced
+            flushTraffic();
+
+            m_node = node.value();
 
             p_db->updateRuntimeValue(
-                RuntimeValue(RunTimeValues::CURRENT_NODE_ID, node.id));
+                RuntimeValue(RunTimeValues::CURRENT_NODE_ID, m_node.id));
             p_db->updateRuntimeValue(
-                RuntimeValue(RunTimeValues::CURRENT_GROUP_ID, node.group_id));
+                RuntimeValue(RunTimeValues::CURRENT_GROUP_ID, m_node.group_id));
 
             emit currentGroupIDChanged();
             emit currentNodeIDChanged();
@@ -387,24 +687,20 @@ void NodeList::setCurrentNodeByID(int id) {
             emit currentNodeChanged(m_node);
 
             if (!run()) {
-                p_logger->error("Failed to start current node: {} {}", node.id,
-                                node.name.toStdString());
+                p_logger->error("Failed to start current node: {} {}",
+                                m_node.id, m_node.name.toStdString());
             }
-
-            break;
-        }
-    }
+        });
 }
 
 void NodeList::handleLatencyChanged(qint64 group_id, int index,
-                                    const NodeInfo &node) {
-    auto db_future = QtConcurrent::run([&, node] {
-        auto t_node = node;
-        p_db->update(t_node);
-    });
+                                    const NodeSummary &node) {
+    // coalesced with the other results of a group ping into one transaction
+    p_db->queueLatency(node.id, node.latency);
+
     if (group_id == displayGroupID()) {
-        if (index < m_nodes.size()) {
-            m_nodes[index] = node;
+        if (index < m_nodes.size() && m_nodes.at(index).id == node.id) {
+            m_nodes[index].latency = node.latency;
             emit itemReset(index);
         }
     }
@@ -413,32 +709,55 @@ void NodeList::handleLatencyChanged(qint64 group_id, int index,
         m_tasks.dequeue();
 }
 
-void NodeList::saveQRCodeToFile(int id, const QUrl &url) {
-    auto iter = std::find_if(m_nodes.begin(), m_nodes.end(),
-                             [&](NodeInfo &item) { return item.id == id; });
-    if (iter == m_nodes.end()) {
-        p_logger->error("Failed to load node info: {}", id);
+void NodeList::flushTraffic() {
+    // reset on every flush, pending usage never moves to another node
+    auto pending = m_pending_traffic;
+    m_pending_traffic = {};
+
+    if (p_db == nullptr || pending.node_id == 0)
         return;
-    }
 
-    if (auto filename = url.fileName(); !filename.isEmpty()) {
-        if (filename.contains("*")) {
-            filename = iter->name;
-        }
+    if (pending.upload > 0 || pending.download > 0)
+        p_db->updateTraffic(pending);
+}
 
-        if (!filename.contains(".png")) {
-            filename.append(".png");
-        }
+void NodeList::resetTrafficBaseline(bool is_core_reset) {
+    // a new core run counts from zero, otherwise the next sample is the
+    // baseline
+    m_traffic_last.clear();
+    m_traffic_last_rate.clear();
+    m_traffic_sum.clear();
+    m_has_traffic_baseline = is_core_reset;
+}
+
+void NodeList::saveQRCodeToFile(int id, const QUrl &url) {
+    p_db->getNodeByIDAsync(id).then(
+        this, [this, id, url](const std::optional<NodeInfo> &node) {
+            if (!node.has_value()) {
+                p_logger->error("Failed to load node info: {}", id);
+                return;
+            }
 
-        auto path = QUrl(url.toString(QUrl::RemoveFilename)).toLocalFile();
-        auto file_path = path.append(filename);
-        auto img = QRCodeTools().write(iter->url);
+            if (auto filename = url.fileName(); !filename.isEmpty()) {
+                if (filename.contains("*")) {
+                    filename = node->name;
+                }
 
-        if (!img.save(file_path) || img.isNull()) {
-            p_logger->error("Failed to save image: {}",
-                            file_path.toStdString());
-        }
-    }
+                if (!filename.contains(".png")) {
+                    filename.append(".png");
+                }
+
+                auto path =
+                    QUrl(url.toString(QUrl::RemoveFilename)).toLocalFile();
+                auto file_path = path.append(filename);
+                auto img = QRCodeTools().write(node->url);
+
+                if (!img.save(file_path) || img.isNull()) {
+                    p_logger->error("Failed to save image: {}",
+                                    file_path.toStdString());
+                }
+            }
+        });
 }
 
 void NodeList::setAsDefault(int id) {
@@ -457,7 +776,7 @@ void NodeList::setDocument(QVariant &v) {
 
 Q_INVOKABLE void NodeList::testLatency(int id) {
     auto iter = std::find_if(m_nodes.begin(), m_nodes.end(),
-                             [&](NodeInfo &item) { return item.id == id; });
+                             [&](NodeSummary &item) { return item.id == id; });
     if (iter == m_nodes.end()) {
         p_logger->error("Failed to load node info: {}", id);
         return;
@@ -469,7 +788,7 @@ Q_INVOKABLE void NodeList::testLatency(int id) {
     }
 }
 
-void NodeList::testLatency(const NodeInfo &node, int index,
+void NodeList::testLatency(const NodeSummary &node, int index,
                            std::function<void()> after) {
     m_tasks.enqueue(
         QtConcurrent::run([this, index, node, after{std::move(after)}] {
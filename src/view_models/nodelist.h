@@ -17,8 +17,10 @@
 #include <QObject>
 #include <QPointer>
 #include <QQuickTextDocument>
+#include <QSet>
 #include <QSharedPointer>
 #include <QSystemTrayIcon>
+#include <QTimer>
 #include <QUrl>
 #include <QVariant>
 #include <QtConcurrent>
@@ -55,20 +57,32 @@ class NodeList : public QObject {
 
     QString generateConfig();
 
-    void setFilter(const QMap<qint64, QList<qint64>> &search_results);
+    // shows group_id, or the first group when it has no results
+    void setFilter(const QMap<qint64, QList<qint64>> &search_results,
+                   qint64 group_id);
     void clearFilter();
 
     void clearItems();
-    void reloadItems();
+    void reloadItems(std::function<void()> after = [] {});
+
+    [[nodiscard]] bool canFetchMore() const;
+    void fetchMore();
 
     void appendNode(NodeInfo node);
     void updateNode(NodeInfo node);
+    // bulk edits, one transaction and one model update per call, the IDs
+    // come from QML as arrays of numbers
+    Q_INVOKABLE void removeNodes(const QVariantList &nodes_id);
+    Q_INVOKABLE void moveNodes(const QVariantList &nodes_id, qint64 group_id);
+    Q_INVOKABLE void copyNodes(const QVariantList &nodes_id, qint64 group_id);
+    Q_INVOKABLE void setNodesRouting(const QVariantList &nodes_id,
+                                     qint64 routing_id);
 
     void setUploadTraffic(double newUploadTraffic);
     void setDownloadTraffic(double newDownloadTraffic);
 
-    void testLatency(
-        const NodeInfo &node, int index, std::function<void()> after = [] {});
+    void testLatency(const NodeSummary &node, int index,
+                     std::function<void()> after = [] {});
 
     void setDownloadProxy(across::network::DownloadTask &task);
 
@@ -78,6 +92,8 @@ class NodeList : public QObject {
     Q_INVOKABLE void setCurrentNodeByID(int id);
     Q_INVOKABLE void removeNodeByID(int id);
     Q_INVOKABLE QVariantMap getNodeInfoByIndex(int index);
+    // returns -1 for rows that are not loaded yet, they are counted and
+    // fetched in the background and nodeLocated follows
     Q_INVOKABLE qint64 getIndexByNode(qint64 node_id, qint64 group_id);
 
     Q_INVOKABLE void testLatency(int id);
@@ -91,7 +107,8 @@ class NodeList : public QObject {
     Q_INVOKABLE static QString jsonFormat(const QString &json_str);
 
   public:
-    QList<NodeInfo> items();
+    QList<NodeSummary> items();
+    std::optional<NodeInfo> getNodeByID(qint64 node_id);
     [[nodiscard]] qint64 currentNodeID() const;
     [[nodiscard]] qint64 currentGroupID() const;
     [[nodiscard]] qint64 displayGroupID() const;
@@ -101,12 +118,14 @@ class NodeList : public QObject {
 
   public slots:
     void setDisplayGroupID(int group_id);
+    void flushTraffic();
     void handleLatencyChanged(qint64 group_id, int index,
-                              const across::NodeInfo &node);
+                              const across::NodeSummary &node);
 
   signals:
     void itemReset(int index);
-    void itemLatencyChanged(qint64 group_id, int index, across::NodeInfo node);
+    void itemLatencyChanged(qint64 group_id, int index,
+                            across::NodeSummary node);
 
     void preItemsReset();
     void postItemsReset();
@@ -121,6 +140,7 @@ class NodeList : public QObject {
     void currentNodeIDChanged();
     void currentGroupIDChanged();
     void displayGroupIDChanged();
+    void nodeLocated(qint64 index);
 
     void nodeLatencyChanged(int id, const QString &group, int latency);
 
@@ -131,6 +151,20 @@ class NodeList : public QObject {
     void currentNodeChanged(const NodeInfo &nodeInfo);
 
   private:
+    QFuture<QList<NodeSummary>> nextPage(qint64 group_id, qsizetype offset);
+    [[nodiscard]] bool isFiltered(qint64 group_id) const;
+    [[nodiscard]] bool hasMore(qint64 group_id, qsizetype received) const;
+    static QList<qint64> toNodesID(const QVariantList &values);
+    void resetTrafficBaseline(bool is_core_reset);
+    // drops the rows from the listing and the filter without a reload
+    void dropNodes(const QList<qint64> &nodes_id, QSet<qint64> groups_id);
+    // emits groupSizeChanged once the counter has been read
+    void refreshGroupSize(qint64 group_id);
+
+  private:
+    static constexpr int PAGE_SIZE = 256;
+    static constexpr int TRAFFIC_FLUSH_INTERVAL = 30 * 1000;
+
     std::shared_ptr<spdlog::logger> p_logger;
     QSharedPointer<DBTools> p_db;
     QSharedPointer<across::core::APITools> p_api;
@@ -143,16 +177,25 @@ class NodeList : public QObject {
     across::JSONHighlighter jsonHighlighter;
 
     NodeInfo m_node;
-    QList<NodeInfo> m_nodes;
-    QList<NodeInfo> m_origin_nodes;
+    QList<NodeSummary> m_nodes;
     qint64 m_display_group_id = 1;
 
+    // bumped on every reload so pages of a previous listing are dropped
+    quint64 m_generation = 0;
+    bool m_has_more = false;
+    bool m_is_fetching = false;
+
     QMap<qint64, QList<qint64>> m_search_results;
 
     across::core::TrafficInfo m_traffic = {0, 0};
     across::core::TrafficInfo m_traffic_last = {0, 0};
     across::core::TrafficInfo m_traffic_last_rate = {0, 0};
     across::core::TrafficInfo m_traffic_sum = {0, 0};
+    bool m_has_traffic_baseline = true;
+
+    // usage of the current node not yet written to the database
+    NodeTraffic m_pending_traffic;
+    QTimer m_traffic_timer;
 };
 } // namespace across
 
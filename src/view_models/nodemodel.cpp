@@ -25,35 +25,48 @@ QVariant NodeModel::data(const QModelIndex &index, int role) const {
         return {};
     }
 
-    const NodeInfo item = p_list->items().at(index.row());
+    const NodeSummary item = p_list->items().at(index.row());
 
     switch (role) {
     case IDRole:
         return QVariant::fromValue(item.id);
     case NameRole:
         return item.name;
-    case GroupRole:
-        return item.group_name;
     case GroupIDRole:
         return item.group_id;
-    case RoutingRole:
-        return item.routing_name;
-    case RoutingIDRole:
-        return item.routing_id;
     case ProtocolTypeRole:
         return item.protocol;
     case AddressRole:
         return item.address;
     case PortRole:
         return item.port;
+    case LatencyRole:
+        return item.latency;
+    case RoutingRole:
+        return item.routing_name;
+    case RoutingIDRole:
+        return item.routing_id;
+    }
+
+    return detail(item.id, role);
+}
+
+QVariant NodeModel::detail(qint64 node_id, int role) const {
+    auto node = p_list->getNodeByID(node_id);
+    if (!node.has_value())
+        return {};
+
+    const NodeInfo &item = node.value();
+
+    switch (role) {
+    case GroupRole:
+        return item.group_name;
     case PasswordRole:
         return item.password;
     case RawRole:
-        return item.raw;
+        return item.rawJson();
     case URLRole:
         return item.url;
-    case LatencyRole:
-        return item.latency;
     case UploadRole:
         return item.upload;
     case DownloadRole:
@@ -89,6 +102,20 @@ QHash<int, QByteArray> NodeModel::roleNames() const {
     return roles;
 }
 
+bool NodeModel::canFetchMore(const QModelIndex &parent) const {
+    if (parent.isValid() || !p_list)
+        return false;
+
+    return p_list->canFetchMore();
+}
+
+void NodeModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid() || !p_list)
+        return;
+
+    p_list->fetchMore();
+}
+
 NodeList *NodeModel::list() const { return p_list; }
 
 void NodeModel::connectItems() {
@@ -43,6 +43,9 @@ class NodeModel : public QAbstractListModel {
 
     [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
 
+    [[nodiscard]] bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
     [[nodiscard]] NodeList *list() const;
 
     void connectItems();
@@ -54,6 +57,8 @@ class NodeModel : public QAbstractListModel {
     void listChanged();
 
   private:
+    QVariant detail(qint64 node_id, int role) const;
+
     NodeList *p_list;
     int m_old_rows = -1;
 };
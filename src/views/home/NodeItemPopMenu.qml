@@ -7,6 +7,7 @@ Menu {
     id: nodeItemPopMenu
 
     property real menuWidth: 168
+    property var nodesID: [nodeID]
 
     topPadding: acrossConfig.borderRadius * 2
     bottomPadding: acrossConfig.borderRadius * 2
@@ -63,10 +64,84 @@ Menu {
 
     }
 
+    Menu {
+        id: moveMenu
+
+        title: qsTr("Move to")
+
+        Instantiator {
+            onObjectAdded: (index, object) => {
+                return moveMenu.insertItem(index, object);
+            }
+            onObjectRemoved: (index, object) => {
+                return moveMenu.removeItem(object);
+            }
+
+            model: GroupModel {
+                list: acrossGroups
+            }
+
+            delegate: MenuItem {
+                text: name
+                enabled: group_id !== groupID
+                onTriggered: {
+                    acrossNodes.moveNodes(nodesID, group_id);
+                }
+            }
+
+        }
+
+    }
+
+    Menu {
+        id: copyMenu
+
+        title: qsTr("Copy to")
+
+        Instantiator {
+            onObjectAdded: (index, object) => {
+                return copyMenu.insertItem(index, object);
+            }
+            onObjectRemoved: (index, object) => {
+                return copyMenu.removeItem(object);
+            }
+
+            model: GroupModel {
+                list: acrossGroups
+            }
+
+            delegate: MenuItem {
+                text: name
+                onTriggered: {
+                    acrossNodes.copyNodes(nodesID, group_id);
+                }
+            }
+
+        }
+
+    }
+
+    Action {
+        text: qsTr("Reset Routing")
+        onTriggered: {
+            // 0 is the built-in routing every node starts with
+            acrossNodes.setNodesRouting(nodesID, 0);
+        }
+    }
+
+    MenuSeparator {
+
+        background: Rectangle {
+            height: 1
+            color: acrossConfig.deepColor
+        }
+
+    }
+
     Action {
         text: qsTr("Delete")
         onTriggered: {
-            acrossNodes.removeNodeByID(nodeID);
+            acrossNodes.removeNodes(nodesID);
         }
     }
 
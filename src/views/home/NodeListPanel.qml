@@ -58,6 +58,14 @@ Item {
     implicitWidth: 648
     implicitHeight: 480
 
+    Connections {
+        function onNodeLocated(index) {
+            locate(index);
+        }
+
+        target: acrossNodes
+    }
+
     GridView {
         id: nodeGridView
 
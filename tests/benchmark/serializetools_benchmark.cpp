@@ -0,0 +1,112 @@
+#include "../common/qurldecoders.h"
+
+#include <QObject>
+#include <QtTest>
+
+using namespace across;
+using namespace across::legacy;
+
+class SerializeToolsBenchmark : public QObject {
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+
+    void sip002Decode_data();
+    void sip002Decode();
+    void trojanDecode_data();
+    void trojanDecode();
+    void vmessPayload_data();
+    void vmessPayload();
+    void vmessBase64Decode();
+
+  private:
+    static void addParsers();
+
+    std::string m_sip002;
+    std::string m_trojan;
+    std::string m_vmess;
+};
+
+// both decoders are checked for equal results by tst_serializetools
+void SerializeToolsBenchmark::initTestCase() {
+    m_sip002 = "ss://" +
+               Base64Tools::encode("chacha20-ietf-poly1305:password",
+                                   Base64Tools::Alphabet::url_safe, false) +
+               "@example.com:8388/?plugin=obfs-local#Tokyo%2001";
+
+    m_trojan = "trojan://password@example.com:443?sni=cdn.example.com&"
+               "allowinsecure=false&alpn=h2%0Ahttp/1.1#Tokyo%2002";
+
+    m_vmess = "vmess://" +
+              Base64Tools::encode(
+                  R"({"v":"2","ps":"Tokyo 03","add":"111.111.111.111",)"
+                  R"("port":"32000","id":"1386f85e-657b-4d6e-9d56-)"
+                  R"(78badb75e1fd","aid":"0","scy":"auto","net":"ws",)"
+                  R"("type":"none","host":"www.bbb.com","path":"/",)"
+                  R"("tls":"tls","sni":"www.ccc.com"})");
+}
+
+void SerializeToolsBenchmark::addParsers() {
+    QTest::addColumn<bool>("is_tokenizer");
+
+    QTest::newRow("qurl") << false;
+    QTest::newRow("string_view") << true;
+}
+
+void SerializeToolsBenchmark::sip002Decode_data() { addParsers(); }
+
+void SerializeToolsBenchmark::sip002Decode() {
+    QFETCH(bool, is_tokenizer);
+
+    if (is_tokenizer) {
+        QBENCHMARK {
+            SerializeTools::sip002Decode(m_sip002);
+        }
+    } else {
+        QBENCHMARK {
+            qurlSip002Decode(m_sip002);
+        }
+    }
+}
+
+void SerializeToolsBenchmark::trojanDecode_data() { addParsers(); }
+
+void SerializeToolsBenchmark::trojanDecode() {
+    QFETCH(bool, is_tokenizer);
+
+    if (is_tokenizer) {
+        QBENCHMARK {
+            SerializeTools::trojanDecode(m_trojan);
+        }
+    } else {
+        QBENCHMARK {
+            qurlTrojanDecode(m_trojan);
+        }
+    }
+}
+
+void SerializeToolsBenchmark::vmessPayload_data() { addParsers(); }
+
+void SerializeToolsBenchmark::vmessPayload() {
+    QFETCH(bool, is_tokenizer);
+
+    if (is_tokenizer) {
+        QBENCHMARK {
+            tokenizerVMessPayload(m_vmess);
+        }
+    } else {
+        QBENCHMARK {
+            qurlVMessPayload(m_vmess);
+        }
+    }
+}
+
+void SerializeToolsBenchmark::vmessBase64Decode() {
+    QBENCHMARK {
+        SerializeTools::vmessBase64Decode(m_vmess);
+    }
+}
+
+QTEST_GUILESS_MAIN(SerializeToolsBenchmark)
+#include "serializetools_benchmark.moc"
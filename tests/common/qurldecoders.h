@@ -0,0 +1,125 @@
+#ifndef QURLDECODERS_H
+#define QURLDECODERS_H
+
+#include "../../src/models/serializetools.h"
+
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QUrlQuery>
+
+// the QUrl based decoders replaced by the ShareLink tokenizer, kept as they
+// were so both sides of a comparison build the same outbound
+namespace across::legacy {
+inline std::optional<URLMetaObject>
+qurlSip002Decode(const std::string &url_str) {
+    QUrl url(url_str.c_str());
+
+    URLMetaObject meta;
+    meta.name = url.fragment(QUrl::FullyDecoded).toStdString();
+
+    auto outbound = &meta.outbound;
+    outbound->set_protocol("shadowsocks");
+    outbound->set_sendthrough("0.0.0.0");
+
+    auto shadowsocks = outbound->mutable_settings()->mutable_shadowsocks();
+    auto server = shadowsocks->add_servers();
+
+    QString user_info = QByteArray::fromBase64(url.userInfo().toUtf8());
+    if (user_info.isEmpty())
+        return {};
+
+    server->set_address(url.host().toStdString());
+    server->set_port(url.port());
+    server->set_password(user_info.split(":").last().toStdString());
+    server->set_method(user_info.split(":").first().toStdString());
+
+    return meta;
+}
+
+inline std::optional<URLMetaObject>
+qurlTrojanDecode(const std::string &url_str) {
+    QUrl url(url_str.c_str());
+
+    URLMetaObject meta;
+    meta.name = url.fragment(QUrl::FullyDecoded).toStdString();
+
+    auto outbound = &meta.outbound;
+    outbound->set_protocol("trojan");
+    outbound->set_sendthrough("0.0.0.0");
+
+    auto trojan = outbound->mutable_settings()->mutable_trojan();
+    auto server = trojan->add_servers();
+
+    if (url.host().isEmpty() || url.userInfo().isEmpty() ||
+        !url.scheme().contains("trojan"))
+        return {};
+
+    server->set_address(url.host().toStdString());
+    server->set_port(url.port());
+    server->set_password(url.userInfo().toStdString());
+
+    if (url.hasQuery()) {
+        QUrlQuery url_query(url);
+
+        auto stream = outbound->mutable_streamsettings();
+        auto tls = stream->mutable_tlssettings();
+
+        if (url_query.hasQueryItem("sni")) {
+            tls->set_servername(url_query.queryItemValue("sni").toStdString());
+        }
+
+        if (url_query.hasQueryItem("allowinsecure")) {
+            if (url_query.queryItemValue("allowinsecure")
+                    .toLower()
+                    .contains("true"))
+                tls->set_allowinsecure(true);
+        } else {
+            stream->set_network("tcp");
+            stream->set_security("tls");
+        }
+
+        if (url_query.hasQueryItem("alpn")) {
+            auto alpn = url_query.queryItemValue("alpn", QUrl::FullyDecoded);
+
+            QStringList values;
+
+            if (alpn.contains(",")) {
+                values = alpn.split(",");
+            } else if (alpn.contains("\n")) {
+                values = alpn.split("\n");
+            }
+
+            if (values.empty()) {
+                tls->add_alpn(alpn.toStdString());
+            } else {
+                for (auto &item : values) {
+                    tls->add_alpn(item.toStdString());
+                }
+            }
+        } else {
+            tls->add_alpn("http/1.1");
+        }
+    }
+
+    return meta;
+}
+
+// only the payload handling of vmess changed, the JSON mapping is shared
+inline Json qurlVMessPayload(const std::string &url_str) {
+    QString info = QString::fromStdString(url_str).split("://").takeLast();
+    QString base64_str = QByteArray::fromBase64(info.toUtf8());
+
+    return Json::parse(base64_str.toStdString());
+}
+
+inline Json tokenizerVMessPayload(const std::string &url_str) {
+    std::string_view info = url_str;
+    if (auto separator = info.rfind("://"); separator != std::string::npos)
+        info.remove_prefix(separator + 3);
+
+    return Json::parse(Base64Tools::decode(info));
+}
+} // namespace across::legacy
+
+#endif // QURLDECODERS_H
@@ -0,0 +1,178 @@
+#include "../../src/models/base64tools.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QtTest>
+
+using namespace across;
+
+Q_DECLARE_METATYPE(Base64Tools::Kernel)
+
+namespace {
+// kernels work on blocks of 16 or 32 characters and 12 or 24 bytes, every
+// size up to this crosses the edges of one and of several blocks
+constexpr int MAX_LENGTH = 100;
+
+QByteArray sample(int size) {
+    QByteArray data(size, '\0');
+    for (int i = 0; i < size; ++i)
+        data[i] = static_cast<char>((i * 37 + size * 11 + 5) & 0xff);
+    return data;
+}
+
+std::string_view view(const QByteArray &data) {
+    return {data.constData(), static_cast<size_t>(data.size())};
+}
+
+QByteArray fromStd(const std::string &data) {
+    return {data.data(), static_cast<qsizetype>(data.size())};
+}
+
+QByteArray::Base64Options options(Base64Tools::Alphabet alphabet,
+                                  bool padding) {
+    QByteArray::Base64Options result;
+    if (alphabet == Base64Tools::Alphabet::url_safe)
+        result |= QByteArray::Base64UrlEncoding;
+    if (!padding)
+        result |= QByteArray::OmitTrailingEquals;
+    return result;
+}
+
+// feeds the decoder in two pieces, split anywhere inside a quad
+QByteArray decodeSplit(const QByteArray &encoded, qsizetype split) {
+    std::string result(Base64Decoder::maxDecodedSize(encoded.size()), '\0');
+
+    Base64Decoder decoder;
+    auto written = decoder.decode(encoded.constData(),
+                                  static_cast<size_t>(split), result.data());
+    written += decoder.decode(encoded.constData() + split,
+                              static_cast<size_t>(encoded.size() - split),
+                              result.data() + written);
+    written += decoder.finish(result.data() + written);
+
+    result.resize(written);
+    return fromStd(result);
+}
+} // namespace
+
+class TestBase64Tools : public QObject {
+    Q_OBJECT
+
+  private slots:
+    void cleanup();
+
+    void encode_data();
+    void encode();
+    void decode_data();
+    void decode();
+    void lineBreaks_data();
+    void lineBreaks();
+    void splitQuads_data();
+    void splitQuads();
+
+  private:
+    static void addKernels();
+};
+
+void TestBase64Tools::cleanup() {
+    Base64Tools::setKernel(Base64Tools::Kernel::automatic);
+}
+
+void TestBase64Tools::addKernels() {
+    QTest::addColumn<Base64Tools::Kernel>("kernel");
+
+    QTest::newRow("scalar") << Base64Tools::Kernel::scalar;
+    QTest::newRow("ssse3") << Base64Tools::Kernel::ssse3;
+    QTest::newRow("avx2") << Base64Tools::Kernel::avx2;
+}
+
+void TestBase64Tools::encode_data() { addKernels(); }
+
+void TestBase64Tools::encode() {
+    QFETCH(Base64Tools::Kernel, kernel);
+    if (!Base64Tools::setKernel(kernel))
+        QSKIP("the kernel is not supported by this CPU");
+    QCOMPARE(Base64Tools::kernel(), kernel);
+
+    for (auto alphabet :
+         {Base64Tools::Alphabet::standard, Base64Tools::Alphabet::url_safe}) {
+        for (auto padding : {true, false}) {
+            for (int size = 0; size <= MAX_LENGTH; ++size) {
+                auto data = sample(size);
+                auto encoded =
+                    fromStd(Base64Tools::encode(view(data), alphabet, padding));
+
+                QCOMPARE(encoded, data.toBase64(options(alphabet, padding)));
+            }
+        }
+    }
+}
+
+void TestBase64Tools::decode_data() { addKernels(); }
+
+void TestBase64Tools::decode() {
+    QFETCH(Base64Tools::Kernel, kernel);
+    if (!Base64Tools::setKernel(kernel))
+        QSKIP("the kernel is not supported by this CPU");
+
+    for (auto alphabet :
+         {Base64Tools::Alphabet::standard, Base64Tools::Alphabet::url_safe}) {
+        for (auto padding : {true, false}) {
+            for (int size = 0; size <= MAX_LENGTH; ++size) {
+                auto data = sample(size);
+                auto encoded = data.toBase64(options(alphabet, padding));
+                auto decoded = fromStd(Base64Tools::decode(view(encoded)));
+
+                QCOMPARE(decoded, data);
+                QCOMPARE(decoded, QByteArray::fromBase64(
+                                      encoded, options(alphabet, padding)));
+            }
+        }
+    }
+}
+
+void TestBase64Tools::lineBreaks_data() { addKernels(); }
+
+void TestBase64Tools::lineBreaks() {
+    QFETCH(Base64Tools::Kernel, kernel);
+    if (!Base64Tools::setKernel(kernel))
+        QSKIP("the kernel is not supported by this CPU");
+
+    for (auto alphabet :
+         {Base64Tools::Alphabet::standard, Base64Tools::Alphabet::url_safe}) {
+        // long enough for two AVX2 blocks and a tail
+        auto data = sample(MAX_LENGTH);
+        auto encoded = data.toBase64(options(alphabet, true));
+
+        for (qsizetype offset = 0; offset <= encoded.size(); ++offset) {
+            auto wrapped = encoded;
+            wrapped.insert(offset, "\r\n");
+
+            auto decoded = fromStd(Base64Tools::decode(view(wrapped)));
+            QCOMPARE(decoded, data);
+            QCOMPARE(decoded, QByteArray::fromBase64(
+                                  wrapped, options(alphabet, true)));
+        }
+    }
+}
+
+void TestBase64Tools::splitQuads_data() { addKernels(); }
+
+void TestBase64Tools::splitQuads() {
+    QFETCH(Base64Tools::Kernel, kernel);
+    if (!Base64Tools::setKernel(kernel))
+        QSKIP("the kernel is not supported by this CPU");
+
+    // line broken the way subscriptions arrive from curl
+    auto data = sample(MAX_LENGTH);
+    auto encoded =
+        data.toBase64(options(Base64Tools::Alphabet::url_safe, false));
+    for (qsizetype offset = 19; offset < encoded.size(); offset += 20)
+        encoded.insert(offset, "\r\n");
+
+    for (qsizetype split = 0; split <= encoded.size(); ++split)
+        QCOMPARE(decodeSplit(encoded, split), data);
+}
+
+QTEST_GUILESS_MAIN(TestBase64Tools)
+#include "tst_base64tools.moc"
@@ -0,0 +1,78 @@
+#include "../common/qurldecoders.h"
+
+#include <QObject>
+#include <QtTest>
+
+using namespace across;
+using namespace across::legacy;
+
+class TestSerializeTools : public QObject {
+    Q_OBJECT
+
+  private slots:
+    void sip002PluginPath();
+    void trojanAlpnLines();
+    void vmessPayload();
+};
+
+void TestSerializeTools::sip002PluginPath() {
+    auto url = "ss://" +
+               Base64Tools::encode("chacha20-ietf-poly1305:password",
+                                   Base64Tools::Alphabet::url_safe, false) +
+               "@example.com:8388/?plugin=obfs-local#Tokyo%2001";
+
+    auto meta = SerializeTools::sip002Decode(url);
+    QVERIFY(meta.has_value());
+    QCOMPARE(QString::fromStdString(meta->name), QString("Tokyo 01"));
+
+    const auto &server = meta->outbound.settings().shadowsocks().servers(0);
+    QCOMPARE(QString::fromStdString(server.address()), QString("example.com"));
+    QCOMPARE(server.port(), 8388u);
+    QCOMPARE(QString::fromStdString(server.method()),
+             QString("chacha20-ietf-poly1305"));
+    QCOMPARE(QString::fromStdString(server.password()), QString("password"));
+
+    auto legacy = qurlSip002Decode(url);
+    QVERIFY(legacy.has_value());
+    QVERIFY(meta->name == legacy->name);
+    QVERIFY(meta->outbound.SerializeAsString() ==
+            legacy->outbound.SerializeAsString());
+}
+
+void TestSerializeTools::trojanAlpnLines() {
+    const std::string url =
+        "trojan://password@example.com:443?sni=cdn.example.com&"
+        "allowinsecure=false&alpn=h2%0Ahttp/1.1#Tokyo%2002";
+
+    auto meta = SerializeTools::trojanDecode(url);
+    QVERIFY(meta.has_value());
+    QCOMPARE(QString::fromStdString(meta->name), QString("Tokyo 02"));
+
+    const auto &tls = meta->outbound.streamsettings().tlssettings();
+    QCOMPARE(QString::fromStdString(tls.servername()),
+             QString("cdn.example.com"));
+    QCOMPARE(tls.alpn_size(), 2);
+    QCOMPARE(QString::fromStdString(tls.alpn(0)), QString("h2"));
+    QCOMPARE(QString::fromStdString(tls.alpn(1)), QString("http/1.1"));
+
+    auto legacy = qurlTrojanDecode(url);
+    QVERIFY(legacy.has_value());
+    QVERIFY(meta->name == legacy->name);
+    QVERIFY(meta->outbound.SerializeAsString() ==
+            legacy->outbound.SerializeAsString());
+}
+
+void TestSerializeTools::vmessPayload() {
+    auto url = "vmess://" +
+               Base64Tools::encode(
+                   R"({"v":"2","ps":"Tokyo 03","add":"111.111.111.111",)"
+                   R"("port":"32000","id":"1386f85e-657b-4d6e-9d56-)"
+                   R"(78badb75e1fd","aid":"0","scy":"auto","net":"ws",)"
+                   R"("type":"none","host":"www.bbb.com","path":"/",)"
+                   R"("tls":"tls","sni":"www.ccc.com"})");
+
+    QVERIFY(tokenizerVMessPayload(url) == qurlVMessPayload(url));
+}
+
+QTEST_GUILESS_MAIN(TestSerializeTools)
+#include "tst_serializetools.moc"